@@ -1,16 +1,23 @@
+/* MAP_ANONYMOUS, MAP_HUGETLB and MADV_HUGEPAGE are not part of XOPEN */
+#define _DEFAULT_SOURCE
+
 #include "include/game_of_life.h"
 
 #include <errno.h>
+#include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/mman.h>
 #include <sys/resource.h>
 
+#define HUGE_PAGE_SIZE ((size_t)2 * 1024 * 1024)
+
 static inline size_t cell_index(const Grid *grid, int row, int col) {
     return (size_t)row * (size_t)grid->cols + (size_t)col;
 }
 
 Grid allocate_grid(int rows, int cols) {
-    Grid grid = {rows, cols, NULL};
+    Grid grid = {rows, cols, NULL, GRID_HEAP, 0};
     if (rows <= 0 || cols <= 0) {
         return grid;
     }
@@ -19,15 +26,65 @@ Grid allocate_grid(int rows, int cols) {
     return grid;
 }
 
+Grid allocate_grid_untouched(int rows, int cols, int hugepages) {
+    Grid grid = {rows, cols, NULL, GRID_HEAP, 0};
+    if (rows <= 0 || cols <= 0) {
+        return grid;
+    }
+
+    size_t bytes = (size_t)rows * (size_t)cols;
+    void *cells = MAP_FAILED;
+
+#ifdef MAP_HUGETLB
+    if (hugepages) {
+        const size_t huge_bytes = (bytes + HUGE_PAGE_SIZE - 1) / HUGE_PAGE_SIZE * HUGE_PAGE_SIZE;
+        cells = mmap(NULL, huge_bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (cells != MAP_FAILED) {
+            bytes = huge_bytes;
+            grid.mapping = GRID_MAPPED_HUGETLB;
+        }
+    }
+#endif
+
+    /* No reserved huge pages: fall back to regular pages, transparently huge if possible */
+    if (cells == MAP_FAILED) {
+        cells = mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (cells == MAP_FAILED) {
+            return grid;
+        }
+        grid.mapping = GRID_MAPPED;
+#ifdef MADV_HUGEPAGE
+        if (hugepages) {
+            madvise(cells, bytes, MADV_HUGEPAGE);
+        }
+#endif
+    }
+
+    grid.cells = cells;
+    grid.mapped_bytes = bytes;
+    return grid;
+}
+
 void free_grid(Grid *grid) {
     if (!grid) {
         return;
     }
 
-    free(grid->cells);
+    if (grid->mapping != GRID_HEAP && grid->cells) {
+        munmap(grid->cells, grid->mapped_bytes);
+    } else {
+        free(grid->cells);
+    }
     grid->cells = NULL;
     grid->rows = 0;
     grid->cols = 0;
+    grid->mapping = GRID_HEAP;
+    grid->mapped_bytes = 0;
+}
+
+static Grid default_allocator(int rows, int cols, void *context) {
+    (void)context;
+    return allocate_grid(rows, cols);
 }
 
 static int validate_dimensions(int generations, int rows, int cols, int alive_count) {
@@ -49,17 +106,42 @@ static int validate_dimensions(int generations, int rows, int cols, int alive_co
     return 0;
 }
 
-int load_world_from_file(const char *path, int *generations_out, Grid *grid_out) {
-    if (!path || !generations_out || !grid_out) {
-        return -1;
+#define BINARY_MAGIC "GOLB"
+#define BINARY_VERSION 2u
+#define BINARY_VERSION_NO_RULE 1u
+#define BINARY_RULE_RECORDED (1u << 19)
+#define BINARY_RULE_WRAP (1u << 18)
+#define RLE_LINE_WIDTH 70
+
+size_t packed_row_bytes(int cols) {
+    return ((size_t)cols + 7) / 8;
+}
+
+void pack_cells(const unsigned char *cells, int count, unsigned char *packed) {
+    memset(packed, 0, packed_row_bytes(count));
+    for (int c = 0; c < count; ++c) {
+        packed[c >> 3] |= (unsigned char)((cells[c] ? 1u : 0u) << (c & 7));
     }
+}
 
-    FILE *file = fopen(path, "r");
-    if (!file) {
-        fprintf(stderr, "Failed to open %s: %s\n", path, strerror(errno));
-        return -1;
+void unpack_cells(const unsigned char *packed, int count, unsigned char *cells) {
+    for (int c = 0; c < count; ++c) {
+        cells[c] = (unsigned char)((packed[c >> 3] >> (c & 7)) & 1u);
     }
+}
+
+static void store_u32(unsigned char *dst, uint32_t value) {
+    dst[0] = (unsigned char)(value & 0xFFu);
+    dst[1] = (unsigned char)((value >> 8) & 0xFFu);
+    dst[2] = (unsigned char)((value >> 16) & 0xFFu);
+    dst[3] = (unsigned char)((value >> 24) & 0xFFu);
+}
+
+static uint32_t load_u32(const unsigned char *src) {
+    return (uint32_t)src[0] | ((uint32_t)src[1] << 8) | ((uint32_t)src[2] << 16) | ((uint32_t)src[3] << 24);
+}
 
+static int load_text_world(FILE *file, const char *path, int *generations_out, Grid *grid_out, GridAllocator allocate, void *context) {
     int generations = 0;
     int rows = 0;
     int cols = 0;
@@ -69,19 +151,16 @@ int load_world_from_file(const char *path, int *generations_out, Grid *grid_out)
         fscanf(file, "%d %d", &rows, &cols) != 2 ||
         fscanf(file, "%d", &alive_count) != 1) {
         fprintf(stderr, "Invalid input format in %s\n", path);
-        fclose(file);
         return -1;
     }
 
     if (validate_dimensions(generations, rows, cols, alive_count) != 0) {
-        fclose(file);
         return -1;
     }
 
-    Grid grid = allocate_grid(rows, cols);
+    Grid grid = allocate(rows, cols, context);
     if (!grid.cells) {
         fprintf(stderr, "Failed to allocate matrix of size %dx%d\n", rows, cols);
-        fclose(file);
         return -1;
     }
 
@@ -91,27 +170,367 @@ int load_world_from_file(const char *path, int *generations_out, Grid *grid_out)
         if (fscanf(file, "%d %d", &r, &c) != 2) {
             fprintf(stderr, "Invalid alive cell entry at line %d\n", i + 4);
             free_grid(&grid);
-            fclose(file);
             return -1;
         }
 
         if (r < 0 || r >= rows || c < 0 || c >= cols) {
             fprintf(stderr, "Alive cell coordinates out of bounds: (%d, %d)\n", r, c);
             free_grid(&grid);
-            fclose(file);
             return -1;
         }
 
         grid.cells[cell_index(&grid, r, c)] = 1;
     }
 
-    fclose(file);
+    *generations_out = generations;
+    *grid_out = grid;
+    return 0;
+}
+
+/*
+ * Parses the value of an RLE "rule = B3/S23[:T<cols>,<rows>]" field. The
+ * optional Golly topology suffix selects a torus ('T') or a plane ('P').
+ */
+static int parse_rle_rule(const char *field, LifeRule *rule_out) {
+    char spec[64];
+    if (sscanf(field, "rule = %63[^ \t\r\n,]", spec) != 1) {
+        return -1;
+    }
+
+    char *topology = strchr(spec, ':');
+    int wrap = 0;
+    if (topology) {
+        *topology++ = '\0';
+        if (*topology == 'T' || *topology == 't') {
+            wrap = 1;
+        } else if (*topology != 'P' && *topology != 'p') {
+            return -1;
+        }
+    }
+
+    if (parse_life_rule(spec, rule_out) != 0) {
+        return -1;
+    }
+    rule_out->wrap = wrap;
+    return 0;
+}
+
+/*
+ * RLE: '#' comment lines, then "x = <cols>, y = <rows>[, rule = ...]", then
+ * runs of 'b' (dead) / 'o' (alive) with '$' ending a row and '!' ending the
+ * pattern. The pattern size is taken as the world size. The generation count
+ * is not part of the standard, so it travels in a "#C generations <n>" comment
+ * and defaults to 0 when absent.
+ */
+static int load_rle_world(FILE *file, const char *path, int *generations_out, Grid *grid_out, LifeRule *rule_out, GridAllocator allocate, void *context) {
+    char line[512];
+    int generations = 0;
+    int rows = 0;
+    int cols = 0;
+    int have_header = 0;
+    int have_rule = 0;
+    LifeRule rule;
+
+    while (!have_header && fgets(line, sizeof(line), file)) {
+        if (line[0] == '#') {
+            sscanf(line, "#C generations %d", &generations);
+            continue;
+        }
+
+        if (sscanf(line, " x = %d , y = %d", &cols, &rows) == 2) {
+            have_header = 1;
+        } else if (strspn(line, " \t\r\n") != strlen(line)) {
+            break;
+        }
+    }
+
+    if (!have_header) {
+        fprintf(stderr, "Invalid RLE header in %s\n", path);
+        return -1;
+    }
+
+    const char *rule_field = strstr(line, "rule");
+    if (rule_field) {
+        if (parse_rle_rule(rule_field, &rule) != 0) {
+            fprintf(stderr, "Unsupported RLE rule (expected B/S notation) in %s\n", path);
+            return -1;
+        }
+        have_rule = 1;
+    }
+
+    if (validate_dimensions(generations, rows, cols, 0) != 0) {
+        return -1;
+    }
+
+    Grid grid = allocate(rows, cols, context);
+    if (!grid.cells) {
+        fprintf(stderr, "Failed to allocate matrix of size %dx%d\n", rows, cols);
+        return -1;
+    }
+
+    int r = 0;
+    int c = 0;
+    long run = 0;
+    int ch = 0;
+
+    while ((ch = fgetc(file)) != EOF && ch != '!') {
+        if (ch >= '0' && ch <= '9') {
+            run = run * 10 + (ch - '0');
+            if (run > (long)rows * (long)cols) {
+                fprintf(stderr, "Invalid RLE run length in %s\n", path);
+                free_grid(&grid);
+                return -1;
+            }
+            continue;
+        }
+
+        if (ch == ' ' || ch == '\t' || ch == '\r' || ch == '\n') {
+            continue;
+        }
+
+        const long count = run > 0 ? run : 1;
+        run = 0;
+
+        if (ch == '$') {
+            if (count > (long)rows - (long)r) {
+                fprintf(stderr, "RLE pattern exceeds declared size %dx%d in %s\n", rows, cols, path);
+                free_grid(&grid);
+                return -1;
+            }
+            r += (int)count;
+            c = 0;
+            continue;
+        }
+
+        if (ch != 'b' && ch != 'o') {
+            fprintf(stderr, "Unsupported RLE tag '%c' in %s\n", ch, path);
+            free_grid(&grid);
+            return -1;
+        }
+
+        if (r >= rows || c + count > cols) {
+            fprintf(stderr, "RLE pattern exceeds declared size %dx%d in %s\n", rows, cols, path);
+            free_grid(&grid);
+            return -1;
+        }
+
+        if (ch == 'o') {
+            memset(&grid.cells[cell_index(&grid, r, c)], 1, (size_t)count);
+        }
+        c += (int)count;
+    }
+
+    if (ch != '!') {
+        fprintf(stderr, "Unterminated RLE pattern in %s\n", path);
+        free_grid(&grid);
+        return -1;
+    }
 
     *generations_out = generations;
     *grid_out = grid;
+    if (have_rule && rule_out) {
+        *rule_out = rule;
+    }
     return 0;
 }
 
+/*
+ * The version takes one byte; the other three hold the rule: birth counts in
+ * bits 0-8, survival counts in bits 9-17, then the wrap and "recorded" flags.
+ * Version 1 files left them zero, i.e. no rule recorded.
+ */
+static uint32_t encode_rule_bits(const LifeRule *rule) {
+    if (!rule) {
+        return 0;
+    }
+
+    uint32_t bits = BINARY_RULE_RECORDED | (rule->wrap ? BINARY_RULE_WRAP : 0u);
+    for (int i = 0; i < 18; ++i) {
+        bits |= rule->table[i] ? 1u << i : 0u;
+    }
+    return bits;
+}
+
+static void decode_rule_bits(uint32_t bits, LifeRule *rule_out) {
+    for (int i = 0; i < 18; ++i) {
+        rule_out->table[i] = (unsigned char)((bits >> i) & 1u);
+    }
+    rule_out->wrap = (bits & BINARY_RULE_WRAP) ? 1 : 0;
+}
+
+void encode_binary_header(unsigned char *header, int generations, int generation, int rows, int cols, const LifeRule *rule) {
+    memcpy(header, BINARY_MAGIC, 4);
+    store_u32(header + 4, BINARY_VERSION | encode_rule_bits(rule) << 8);
+    store_u32(header + 8, (uint32_t)generations);
+    store_u32(header + 12, (uint32_t)generation);
+    store_u32(header + 16, (uint32_t)rows);
+    store_u32(header + 20, (uint32_t)cols);
+}
+
+int decode_binary_header(const unsigned char *header, const char *path, int *generations_out, int *generation_out, int *rows_out, int *cols_out, LifeRule *rule_out) {
+    if (memcmp(header, BINARY_MAGIC, 4) != 0) {
+        fprintf(stderr, "Invalid binary header in %s\n", path);
+        return -1;
+    }
+
+    const uint32_t version = header[4];
+    const uint32_t rule_bits = load_u32(header + 4) >> 8;
+    if ((version != BINARY_VERSION && version != BINARY_VERSION_NO_RULE) ||
+        (version == BINARY_VERSION_NO_RULE && rule_bits != 0) || rule_bits >= BINARY_RULE_RECORDED << 1) {
+        fprintf(stderr, "Unsupported binary world version %u in %s\n", (unsigned)load_u32(header + 4), path);
+        return -1;
+    }
+
+    const int generations = (int)load_u32(header + 8);
+    const int generation = (int)load_u32(header + 12);
+    const int rows = (int)load_u32(header + 16);
+    const int cols = (int)load_u32(header + 20);
+
+    if (validate_dimensions(generations, rows, cols, 0) != 0) {
+        return -1;
+    }
+
+    if (generation < 0 || generation > generations) {
+        fprintf(stderr, "Invalid snapshot generation %d of %d in %s\n", generation, generations, path);
+        return -1;
+    }
+
+    *generations_out = generations;
+    *generation_out = generation;
+    *rows_out = rows;
+    *cols_out = cols;
+    if (rule_out && (rule_bits & BINARY_RULE_RECORDED)) {
+        decode_rule_bits(rule_bits, rule_out);
+    }
+    return 0;
+}
+
+static int load_binary_world(FILE *file, const char *path, int *generations_out, int *generation_out, Grid *grid_out, LifeRule *rule_out, GridAllocator allocate, void *context) {
+    unsigned char header[WORLD_BINARY_HEADER_SIZE];
+    int generations = 0;
+    int generation = 0;
+    int rows = 0;
+    int cols = 0;
+
+    if (fread(header, 1, sizeof(header), file) != sizeof(header)) {
+        fprintf(stderr, "Invalid binary header in %s\n", path);
+        return -1;
+    }
+
+    /* Only overwritten when the header records a rule */
+    LifeRule rule = {{0}, 0};
+    if (rule_out) {
+        rule = *rule_out;
+    }
+    if (decode_binary_header(header, path, &generations, &generation, &rows, &cols, &rule) != 0) {
+        return -1;
+    }
+
+    Grid grid = allocate(rows, cols, context);
+    const size_t row_bytes = packed_row_bytes(cols);
+    unsigned char *packed = malloc(row_bytes);
+    if (!grid.cells || !packed) {
+        fprintf(stderr, "Failed to allocate matrix of size %dx%d\n", rows, cols);
+        free_grid(&grid);
+        free(packed);
+        return -1;
+    }
+
+    for (int r = 0; r < rows; ++r) {
+        if (fread(packed, 1, row_bytes, file) != row_bytes) {
+            fprintf(stderr, "Truncated binary world in %s at row %d\n", path, r);
+            free_grid(&grid);
+            free(packed);
+            return -1;
+        }
+
+        unpack_cells(packed, cols, &grid.cells[cell_index(&grid, r, 0)]);
+    }
+
+    free(packed);
+
+    *generations_out = generations;
+    if (generation_out) {
+        *generation_out = generation;
+    }
+    if (rule_out) {
+        *rule_out = rule;
+    }
+    *grid_out = grid;
+    return 0;
+}
+
+static WorldFormat detect_world_format(FILE *file) {
+    unsigned char magic[4] = {0};
+    const size_t got = fread(magic, 1, sizeof(magic), file);
+    rewind(file);
+
+    if (got == sizeof(magic) && memcmp(magic, BINARY_MAGIC, 4) == 0) {
+        return WORLD_FORMAT_BINARY;
+    }
+
+    int ch = 0;
+    while ((ch = fgetc(file)) != EOF && (ch == ' ' || ch == '\t' || ch == '\r' || ch == '\n')) {
+    }
+    rewind(file);
+
+    return (ch == '#' || ch == 'x') ? WORLD_FORMAT_RLE : WORLD_FORMAT_TEXT;
+}
+
+int load_world_from_file(const char *path, int *generations_out, Grid *grid_out, LifeRule *rule_out) {
+    return load_world_from_file_with(path, generations_out, grid_out, rule_out, default_allocator, NULL);
+}
+
+int load_world_from_file_with(const char *path, int *generations_out, Grid *grid_out, LifeRule *rule_out, GridAllocator allocate, void *context) {
+    if (!path || !generations_out || !grid_out || !allocate) {
+        return -1;
+    }
+
+    FILE *file = fopen(path, "rb");
+    if (!file) {
+        fprintf(stderr, "Failed to open %s: %s\n", path, strerror(errno));
+        return -1;
+    }
+
+    int status = -1;
+
+    switch (detect_world_format(file)) {
+    case WORLD_FORMAT_BINARY:
+        status = load_binary_world(file, path, generations_out, NULL, grid_out, rule_out, allocate, context);
+        break;
+    case WORLD_FORMAT_RLE:
+        status = load_rle_world(file, path, generations_out, grid_out, rule_out, allocate, context);
+        break;
+    case WORLD_FORMAT_TEXT:
+    default:
+        status = load_text_world(file, path, generations_out, grid_out, allocate, context);
+        break;
+    }
+
+    fclose(file);
+    return status;
+}
+
+int load_snapshot(const char *path, int *generations_out, int *generation_out, Grid *grid_out, LifeRule *rule_out) {
+    return load_snapshot_with(path, generations_out, generation_out, grid_out, rule_out, default_allocator, NULL);
+}
+
+int load_snapshot_with(const char *path, int *generations_out, int *generation_out, Grid *grid_out, LifeRule *rule_out, GridAllocator allocate, void *context) {
+    if (!path || !generations_out || !generation_out || !grid_out || !allocate) {
+        return -1;
+    }
+
+    FILE *file = fopen(path, "rb");
+    if (!file) {
+        fprintf(stderr, "Failed to open %s: %s\n", path, strerror(errno));
+        return -1;
+    }
+
+    const int status = load_binary_world(file, path, generations_out, generation_out, grid_out, rule_out, allocate, context);
+    fclose(file);
+    return status;
+}
+
 int count_alive_cells(const Grid *grid) {
     if (!grid || !grid->cells) {
         return 0;
@@ -153,52 +572,495 @@ int write_world(FILE *out, int generations, const Grid *grid) {
     return 0;
 }
 
-static unsigned char next_state(const Grid *grid, int row, int col) {
-    int alive_neighbors = 0;
+typedef struct {
+    FILE *out;
+    int width;
+} RleWriter;
 
-    for (int dr = -1; dr <= 1; ++dr) {
-        for (int dc = -1; dc <= 1; ++dc) {
-            if (dr == 0 && dc == 0) {
-                continue;
-            }
+static int rle_emit(RleWriter *writer, int count, char tag) {
+    char token[16];
+    const int len = count > 1 ? snprintf(token, sizeof(token), "%d%c", count, tag)
+                              : snprintf(token, sizeof(token), "%c", tag);
+
+    if (writer->width + len > RLE_LINE_WIDTH) {
+        if (fputc('\n', writer->out) == EOF) {
+            return -1;
+        }
+        writer->width = 0;
+    }
 
-            const int nr = row + dr;
-            const int nc = col + dc;
+    writer->width += len;
+    return fputs(token, writer->out) == EOF ? -1 : 0;
+}
+
+static int write_rle_world(FILE *out, int generations, const Grid *grid, const LifeRule *rule) {
+    char spec[LIFE_RULE_SPEC_SIZE];
+    format_life_rule(rule, spec, sizeof(spec));
+
+    if (fprintf(out, "#C generations %d\n", generations) < 0 ||
+        fprintf(out, "x = %d, y = %d, rule = %s", grid->cols, grid->rows, spec) < 0 ||
+        (rule->wrap && fprintf(out, ":T%d,%d", grid->cols, grid->rows) < 0) ||
+        fputc('\n', out) == EOF) {
+        return -1;
+    }
+
+    RleWriter writer = {out, 0};
+    int pending_rows = 0;
+
+    for (int r = 0; r < grid->rows; ++r) {
+        const unsigned char *row = &grid->cells[cell_index(grid, r, 0)];
+
+        int last_alive = grid->cols - 1;
+        while (last_alive >= 0 && !row[last_alive]) {
+            --last_alive;
+        }
+
+        if (last_alive < 0) {
+            ++pending_rows;
+            continue;
+        }
 
-            if (nr < 0 || nr >= grid->rows || nc < 0 || nc >= grid->cols) {
-                continue;
+        if (pending_rows > 0 && rle_emit(&writer, pending_rows, '$') != 0) {
+            return -1;
+        }
+        pending_rows = 1;
+
+        int c = 0;
+        while (c <= last_alive) {
+            const unsigned char state = row[c];
+            int run = 1;
+            while (c + run <= last_alive && row[c + run] == state) {
+                ++run;
             }
 
-            alive_neighbors += grid->cells[cell_index(grid, nr, nc)] ? 1 : 0;
+            if (rle_emit(&writer, run, state ? 'o' : 'b') != 0) {
+                return -1;
+            }
+            c += run;
         }
     }
 
-    const unsigned char is_alive = grid->cells[cell_index(grid, row, col)];
+    return fputs("!\n", out) == EOF ? -1 : 0;
+}
+
+static int write_binary_world(FILE *out, int generations, int generation, const Grid *grid, const LifeRule *rule) {
+    unsigned char header[WORLD_BINARY_HEADER_SIZE];
+    encode_binary_header(header, generations, generation, grid->rows, grid->cols, rule);
 
-    if (is_alive && (alive_neighbors == 2 || alive_neighbors == 3)) {
-        return 1;
+    if (fwrite(header, 1, sizeof(header), out) != sizeof(header)) {
+        return -1;
     }
 
-    if (!is_alive && alive_neighbors == 3) {
-        return 1;
+    const size_t row_bytes = packed_row_bytes(grid->cols);
+    unsigned char *packed = malloc(row_bytes);
+    if (!packed) {
+        return -1;
     }
 
+    for (int r = 0; r < grid->rows; ++r) {
+        pack_cells(&grid->cells[cell_index(grid, r, 0)], grid->cols, packed);
+
+        if (fwrite(packed, 1, row_bytes, out) != row_bytes) {
+            free(packed);
+            return -1;
+        }
+    }
+
+    free(packed);
     return 0;
 }
 
-void step_range(const Grid *current, Grid *next, int start_row, int end_row) {
-    if (!current || !next || !current->cells || !next->cells) {
+int write_world_as(FILE *out, WorldFormat format, int generations, const Grid *grid, const LifeRule *rule) {
+    if (!out || !grid || !grid->cells) {
+        return -1;
+    }
+
+    LifeRule default_rule;
+    if (!rule) {
+        life_rule_default(&default_rule);
+        rule = &default_rule;
+    }
+
+    switch (format) {
+    case WORLD_FORMAT_RLE:
+        return write_rle_world(out, generations, grid, rule);
+    case WORLD_FORMAT_BINARY:
+        return write_binary_world(out, generations, 0, grid, rule);
+    case WORLD_FORMAT_TEXT:
+    default:
+        return write_world(out, generations, grid);
+    }
+}
+
+int write_snapshot(FILE *out, int generations, int generation, const Grid *grid, const LifeRule *rule) {
+    if (!out || !grid || !grid->cells) {
+        return -1;
+    }
+
+    return write_binary_world(out, generations, generation, grid, rule);
+}
+
+int parse_world_format(const char *name, WorldFormat *format_out) {
+    if (!name || !format_out) {
+        return -1;
+    }
+
+    if (strcmp(name, "text") == 0 || strcmp(name, "txt") == 0) {
+        *format_out = WORLD_FORMAT_TEXT;
+    } else if (strcmp(name, "rle") == 0) {
+        *format_out = WORLD_FORMAT_RLE;
+    } else if (strcmp(name, "bin") == 0 || strcmp(name, "binary") == 0) {
+        *format_out = WORLD_FORMAT_BINARY;
+    } else {
+        return -1;
+    }
+
+    return 0;
+}
+
+const char *world_format_extension(WorldFormat format) {
+    switch (format) {
+    case WORLD_FORMAT_RLE:
+        return "rle";
+    case WORLD_FORMAT_BINARY:
+        return "bin";
+    case WORLD_FORMAT_TEXT:
+    default:
+        return "txt";
+    }
+}
+
+void life_rule_default(LifeRule *rule) {
+    if (!rule) {
         return;
     }
 
+    memset(rule->table, 0, sizeof(rule->table));
+    rule->table[3] = 1;
+    rule->table[9 + 2] = 1;
+    rule->table[9 + 3] = 1;
+    rule->wrap = 0;
+}
+
+int parse_life_rule(const char *spec, LifeRule *rule_out) {
+    if (!spec || !rule_out) {
+        return -1;
+    }
+
+    unsigned char table[18] = {0};
+    int seen_birth = 0;
+    int seen_survival = 0;
+    int section = -1;
+
+    for (const char *p = spec; *p; ++p) {
+        if (*p == 'B' || *p == 'b') {
+            section = 0;
+            seen_birth = 1;
+        } else if (*p == 'S' || *p == 's') {
+            section = 1;
+            seen_survival = 1;
+        } else if (*p >= '0' && *p <= '8' && section >= 0) {
+            table[section * 9 + (*p - '0')] = 1;
+        } else if (*p != '/') {
+            return -1;
+        }
+    }
+
+    if (!seen_birth || !seen_survival) {
+        return -1;
+    }
+
+    memcpy(rule_out->table, table, sizeof(table));
+    return 0;
+}
+
+void format_life_rule(const LifeRule *rule, char *spec, size_t size) {
+    char text[LIFE_RULE_SPEC_SIZE];
+    size_t len = 0;
+
+    text[len++] = 'B';
+    for (int n = 0; n <= 8; ++n) {
+        if (rule->table[n]) {
+            text[len++] = (char)('0' + n);
+        }
+    }
+    text[len++] = '/';
+    text[len++] = 'S';
+    for (int n = 0; n <= 8; ++n) {
+        if (rule->table[9 + n]) {
+            text[len++] = (char)('0' + n);
+        }
+    }
+    text[len] = '\0';
+
+    snprintf(spec, size, "%s", text);
+}
+
+static inline int column_sum(const unsigned char *above, const unsigned char *row, const unsigned char *below, int c) {
+    return above[c] + row[c] + below[c];
+}
+
+/*
+ * Computes out[c0, c1) from the three input rows with a sliding window of
+ * column sums. Interior cells are branch-free table lookups; only the first
+ * and last column of the row look at `wrap`, which is a literal at every call
+ * site so each topology gets its own inlined copy of the loop.
+ *
+ * Returns STEP_* flags comparing each new value with the old cell and with
+ * what `out` held before (the generation before `row` when double buffering).
+ */
+static inline int step_row(const unsigned char *above, const unsigned char *row, const unsigned char *below,
+                           unsigned char *out, int c0, int c1, int cols, const unsigned char *table, int wrap) {
+    if (c0 >= c1) {
+        return 0;
+    }
+
+    unsigned changed = 0;
+    unsigned changed_previous = 0;
+
+    int left = 0;
+    if (c0 > 0) {
+        left = column_sum(above, row, below, c0 - 1);
+    } else if (wrap) {
+        left = column_sum(above, row, below, cols - 1);
+    }
+
+    int mid = column_sum(above, row, below, c0);
+    const int inner_end = c1 < cols ? c1 : cols - 1;
+
+    for (int c = c0; c < inner_end; ++c) {
+        const int right = column_sum(above, row, below, c + 1);
+        const int alive = row[c];
+        const unsigned char value = table[alive * 9 + left + mid + right - alive];
+        changed |= value ^ (unsigned)alive;
+        changed_previous |= value ^ out[c];
+        out[c] = value;
+        left = mid;
+        mid = right;
+    }
+
+    if (c1 == cols) {
+        const int right = wrap ? column_sum(above, row, below, 0) : 0;
+        const int alive = row[cols - 1];
+        const unsigned char value = table[alive * 9 + left + mid + right - alive];
+        changed |= value ^ (unsigned)alive;
+        changed_previous |= value ^ out[cols - 1];
+        out[cols - 1] = value;
+    }
+
+    return (changed ? STEP_CHANGED : 0) | (changed_previous ? STEP_CHANGED_FROM_PREVIOUS : 0);
+}
+
+int step_block(const Grid *current, Grid *next, int start_row, int end_row, int start_col, int end_col, const LifeRule *rule, const unsigned char *dead_row) {
+    if (!current || !next || !current->cells || !next->cells || !rule) {
+        return 0;
+    }
+
+    const int rows = current->rows;
+    const int cols = current->cols;
     const int clamped_start = start_row < 0 ? 0 : start_row;
-    const int clamped_end = end_row > current->rows ? current->rows : end_row;
+    const int clamped_end = end_row > rows ? rows : end_row;
+    const int c0 = start_col < 0 ? 0 : start_col;
+    const int c1 = end_col > cols ? cols : end_col;
+
+    if (clamped_start >= clamped_end || c0 >= c1) {
+        return 0;
+    }
+
+    int flags = 0;
+
+    if (rule->wrap) {
+        for (int r = clamped_start; r < clamped_end; ++r) {
+            const unsigned char *above = &current->cells[cell_index(current, (r + rows - 1) % rows, 0)];
+            const unsigned char *row = &current->cells[cell_index(current, r, 0)];
+            const unsigned char *below = &current->cells[cell_index(current, (r + 1) % rows, 0)];
+            flags |= step_row(above, row, below, &next->cells[cell_index(next, r, 0)], c0, c1, cols, rule->table, 1);
+        }
+        return flags;
+    }
 
+    /* The dead border above the first and below the last row is the caller's zero row */
     for (int r = clamped_start; r < clamped_end; ++r) {
-        for (int c = 0; c < current->cols; ++c) {
-            next->cells[cell_index(next, r, c)] = next_state(current, r, c);
+        const unsigned char *above = r > 0 ? &current->cells[cell_index(current, r - 1, 0)] : dead_row;
+        const unsigned char *row = &current->cells[cell_index(current, r, 0)];
+        const unsigned char *below = r + 1 < rows ? &current->cells[cell_index(current, r + 1, 0)] : dead_row;
+        flags |= step_row(above, row, below, &next->cells[cell_index(next, r, 0)], c0, c1, cols, rule->table, 0);
+    }
+
+    return flags;
+}
+
+int row_cache_init(RowCache *cache, int cols) {
+    cache->cols = cols;
+    cache->rows = calloc((size_t)5 * (size_t)cols, sizeof(unsigned char));
+    cache->above = NULL;
+    cache->below = NULL;
+    return cache->rows ? 0 : -1;
+}
+
+void row_cache_free(RowCache *cache) {
+    if (!cache) {
+        return;
+    }
+    free(cache->rows);
+    cache->rows = NULL;
+}
+
+/* Layout of cache->rows: saved row above, saved row below, two rolling rows, dead row */
+void row_cache_save_halo(RowCache *cache, const Grid *grid, int start_row, int end_row, const LifeRule *rule) {
+    const int cols = cache->cols;
+    const unsigned char *dead = &cache->rows[(size_t)4 * (size_t)cols];
+    int above = start_row - 1;
+    int below = end_row;
+
+    if (rule->wrap) {
+        above = (above + grid->rows) % grid->rows;
+        below %= grid->rows;
+    }
+
+    cache->above = dead;
+    if (above >= 0) {
+        memcpy(cache->rows, &grid->cells[cell_index(grid, above, 0)], (size_t)cols);
+        cache->above = cache->rows;
+    }
+
+    cache->below = dead;
+    if (below < grid->rows) {
+        memcpy(&cache->rows[cols], &grid->cells[cell_index(grid, below, 0)], (size_t)cols);
+        cache->below = &cache->rows[cols];
+    }
+}
+
+static inline int step_rows_in_place(Grid *grid, int start_row, int end_row, RowCache *cache, const unsigned char *table, int wrap) {
+    const int cols = grid->cols;
+    unsigned char *window[2] = {&cache->rows[(size_t)2 * (size_t)cols], &cache->rows[(size_t)3 * (size_t)cols]};
+    const unsigned char *above = cache->above;
+    int flags = 0;
+
+    for (int r = start_row; r < end_row; ++r) {
+        unsigned char *out = &grid->cells[cell_index(grid, r, 0)];
+        unsigned char *row = window[r & 1];
+        const unsigned char *below = r + 1 < end_row ? out + cols : cache->below;
+
+        memcpy(row, out, (size_t)cols);
+        flags |= step_row(above, row, below, out, 0, cols, cols, table, wrap);
+        above = row;
+    }
+
+    return flags;
+}
+
+int step_range_in_place(Grid *grid, int start_row, int end_row, RowCache *cache, const LifeRule *rule) {
+    if (!grid || !grid->cells || !cache || !cache->rows || !rule) {
+        return 0;
+    }
+
+    const int r0 = start_row < 0 ? 0 : start_row;
+    const int r1 = end_row > grid->rows ? grid->rows : end_row;
+    if (r0 >= r1) {
+        return 0;
+    }
+
+    return rule->wrap ? step_rows_in_place(grid, r0, r1, cache, rule->table, 1)
+                      : step_rows_in_place(grid, r0, r1, cache, rule->table, 0);
+}
+
+int step_range_rule(const Grid *current, Grid *next, int start_row, int end_row, const LifeRule *rule, const unsigned char *dead_row) {
+    if (!current) {
+        return 0;
+    }
+
+    return step_block(current, next, start_row, end_row, 0, current->cols, rule, dead_row);
+}
+
+void step_range(const Grid *current, Grid *next, int start_row, int end_row) {
+    if (!current) {
+        return;
+    }
+
+    unsigned char *dead_row = calloc((size_t)current->cols, sizeof(unsigned char));
+    if (!dead_row) {
+        fprintf(stderr, "Failed to allocate the dead border row\n");
+        return;
+    }
+
+    LifeRule rule;
+    life_rule_default(&rule);
+    step_range_rule(current, next, start_row, end_row, &rule, dead_row);
+    free(dead_row);
+}
+
+static void swap_cells(Grid *a, Grid *b) {
+    unsigned char *tmp = a->cells;
+    a->cells = b->cells;
+    b->cells = tmp;
+}
+
+int simulate_generations(Grid *current, Grid *next, int generations, const LifeRule *rule, int early_exit, int *period_out) {
+    unsigned char *dead_row = calloc((size_t)current->cols, sizeof(unsigned char));
+    if (!dead_row) {
+        return -1;
+    }
+
+    int computed = 0;
+    int period = 0;
+
+    while (computed < generations) {
+        const int flags = step_range_rule(current, next, 0, current->rows, rule, dead_row);
+        swap_cells(current, next);
+        ++computed;
+
+        if (!early_exit) {
+            continue;
         }
+
+        /* `next` now holds the generation before `current`; on the first
+         * step it held nothing, so only a still life can be detected there. */
+        if (!(flags & STEP_CHANGED)) {
+            period = 1;
+            break;
+        }
+        if (computed > 1 && !(flags & STEP_CHANGED_FROM_PREVIOUS)) {
+            period = 2;
+            if ((generations - computed) % 2 != 0) {
+                swap_cells(current, next);
+            }
+            break;
+        }
+    }
+
+    free(dead_row);
+    if (period_out) {
+        *period_out = period;
+    }
+    return computed;
+}
+
+int simulate_generations_in_place(Grid *grid, int generations, const LifeRule *rule, int early_exit, int *period_out) {
+    RowCache cache;
+    if (row_cache_init(&cache, grid->cols) != 0) {
+        return -1;
+    }
+
+    int computed = 0;
+    int period = 0;
+
+    while (computed < generations) {
+        row_cache_save_halo(&cache, grid, 0, grid->rows, rule);
+        const int flags = step_range_in_place(grid, 0, grid->rows, &cache, rule);
+        ++computed;
+
+        if (early_exit && !(flags & STEP_CHANGED)) {
+            period = 1;
+            break;
+        }
+    }
+
+    row_cache_free(&cache);
+    if (period_out) {
+        *period_out = period;
     }
+    return computed;
 }
 
 long get_peak_rss_kb(void) {
@@ -0,0 +1,343 @@
+#include "include/game_of_life.h"
+
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Fewer tiny worlds than this with the same shape are cheaper to step one by one */
+#define BATCH_MIN_PACK 8
+
+/*
+ * A task is either one world or a pack of up to BATCH_LANES worlds with the
+ * same size and rule, taken from order[first, first + count).
+ */
+typedef struct {
+    int first;
+    int count;
+    int packed;
+} BatchTask;
+
+typedef struct {
+    BatchWorld **order;
+    const BatchTask *tasks;
+    int task_count;
+    int next_task;
+    int early_exit;
+    int failed;
+    pthread_mutex_t lock;
+} BatchQueue;
+
+static int packable(const BatchWorld *world) {
+    return (long)world->grid.rows * (long)world->grid.cols <= BATCH_LANE_MAX_CELLS;
+}
+
+static int same_pack(const BatchWorld *a, const BatchWorld *b) {
+    return a->grid.rows == b->grid.rows && a->grid.cols == b->grid.cols && a->rule.wrap == b->rule.wrap &&
+           memcmp(a->rule.table, b->rule.table, sizeof(a->rule.table)) == 0;
+}
+
+/* Groups packable worlds of the same shape and rule next to each other */
+static int compare_worlds(const void *lhs, const void *rhs) {
+    const BatchWorld *a = *(BatchWorld *const *)lhs;
+    const BatchWorld *b = *(BatchWorld *const *)rhs;
+
+    if (packable(a) != packable(b)) {
+        return packable(b) - packable(a);
+    }
+    if (a->grid.rows != b->grid.rows) {
+        return a->grid.rows < b->grid.rows ? -1 : 1;
+    }
+    if (a->grid.cols != b->grid.cols) {
+        return a->grid.cols < b->grid.cols ? -1 : 1;
+    }
+    if (a->rule.wrap != b->rule.wrap) {
+        return a->rule.wrap - b->rule.wrap;
+    }
+    const int tables = memcmp(a->rule.table, b->rule.table, sizeof(a->rule.table));
+    if (tables != 0) {
+        return tables;
+    }
+    return a < b ? -1 : (a > b ? 1 : 0);
+}
+
+static int run_single(BatchWorld *world, int early_exit) {
+    Grid buffer = allocate_grid(world->grid.rows, world->grid.cols);
+    if (!buffer.cells) {
+        return -1;
+    }
+
+    Grid current = world->grid;
+    Grid next = buffer;
+    const int computed = simulate_generations(&current, &next, world->generations, &world->rule, early_exit, NULL);
+    if (computed < 0) {
+        free_grid(&buffer);
+        return -1;
+    }
+    world->computed = computed;
+
+    if (current.cells != world->grid.cells) {
+        memcpy(world->grid.cells, current.cells, (size_t)world->grid.rows * (size_t)world->grid.cols);
+    }
+
+    free_grid(&buffer);
+    return 0;
+}
+
+static void extract_lane(const uint64_t *cells, int pitch, BatchWorld *world, int lane) {
+    for (int r = 0; r < world->grid.rows; ++r) {
+        for (int c = 0; c < world->grid.cols; ++c) {
+            const uint64_t word = cells[(size_t)(r + 1) * (size_t)pitch + (size_t)(c + 1)];
+            world->grid.cells[(size_t)r * (size_t)world->grid.cols + (size_t)c] = (unsigned char)((word >> lane) & 1u);
+        }
+    }
+}
+
+static void wrap_halo(uint64_t *cells, int rows, int cols) {
+    const int pitch = cols + 2;
+
+    memcpy(&cells[1], &cells[(size_t)rows * (size_t)pitch + 1], sizeof(uint64_t) * (size_t)cols);
+    memcpy(&cells[(size_t)(rows + 1) * (size_t)pitch + 1], &cells[(size_t)pitch + 1], sizeof(uint64_t) * (size_t)cols);
+    for (int r = 0; r < rows + 2; ++r) {
+        uint64_t *row = &cells[(size_t)r * (size_t)pitch];
+        row[0] = row[cols];
+        row[cols + 1] = row[1];
+    }
+}
+
+/* Adds one neighbour bit per lane to the bit-sliced 4-bit counters s0..s3 */
+static inline void add_neighbour(uint64_t n, uint64_t *s0, uint64_t *s1, uint64_t *s2, uint64_t *s3) {
+    const uint64_t c0 = *s0 & n;
+    *s0 ^= n;
+    const uint64_t c1 = *s1 & c0;
+    *s1 ^= c0;
+    const uint64_t c2 = *s2 & c1;
+    *s2 ^= c1;
+    *s3 |= c2;
+}
+
+/*
+ * Steps up to BATCH_LANES worlds at once: bit `lane` of every word belongs to
+ * one world, the neighbour count is a bit-sliced adder and the rule table is
+ * applied as one mask per neighbour count. Both grids carry a one-cell halo
+ * that stays dead or is refreshed from the opposite edge for toroidal rules.
+ * Each lane is unpacked back into its world as soon as it is done.
+ */
+static int run_packed(BatchWorld *const *lanes, int count, int early_exit) {
+    const BatchWorld *first = lanes[0];
+    const int rows = first->grid.rows;
+    const int cols = first->grid.cols;
+    const int pitch = cols + 2;
+    const size_t words = (size_t)(rows + 2) * (size_t)pitch;
+    uint64_t *current = calloc(words, sizeof(uint64_t));
+    uint64_t *next = calloc(words, sizeof(uint64_t));
+
+    if (!current || !next) {
+        free(current);
+        free(next);
+        return -1;
+    }
+
+    uint64_t born[9];
+    uint64_t survive[9];
+    int counts[9];
+    int count_total = 0;
+    for (int k = 0; k < 9; ++k) {
+        born[k] = first->rule.table[k] ? ~(uint64_t)0 : 0;
+        survive[k] = first->rule.table[9 + k] ? ~(uint64_t)0 : 0;
+        if (born[k] | survive[k]) {
+            counts[count_total++] = k;
+        }
+    }
+
+    uint64_t active = 0;
+    for (int lane = 0; lane < count; ++lane) {
+        BatchWorld *world = lanes[lane];
+        world->computed = 0;
+        if (world->generations > 0) {
+            active |= (uint64_t)1 << lane;
+        }
+        for (int r = 0; r < rows; ++r) {
+            for (int c = 0; c < cols; ++c) {
+                if (world->grid.cells[(size_t)r * (size_t)cols + (size_t)c]) {
+                    current[(size_t)(r + 1) * (size_t)pitch + (size_t)(c + 1)] |= (uint64_t)1 << lane;
+                }
+            }
+        }
+    }
+
+    for (int step = 1; active; ++step) {
+        if (first->rule.wrap) {
+            wrap_halo(current, rows, cols);
+        }
+
+        uint64_t changed = 0;
+        uint64_t changed_previous = 0;
+
+        for (int r = 1; r <= rows; ++r) {
+            const uint64_t *above = &current[(size_t)(r - 1) * (size_t)pitch];
+            const uint64_t *row = &current[(size_t)r * (size_t)pitch];
+            const uint64_t *below = &current[(size_t)(r + 1) * (size_t)pitch];
+            uint64_t *out = &next[(size_t)r * (size_t)pitch];
+
+            for (int c = 1; c <= cols; ++c) {
+                uint64_t s0 = 0;
+                uint64_t s1 = 0;
+                uint64_t s2 = 0;
+                uint64_t s3 = 0;
+                add_neighbour(above[c - 1], &s0, &s1, &s2, &s3);
+                add_neighbour(above[c], &s0, &s1, &s2, &s3);
+                add_neighbour(above[c + 1], &s0, &s1, &s2, &s3);
+                add_neighbour(row[c - 1], &s0, &s1, &s2, &s3);
+                add_neighbour(row[c + 1], &s0, &s1, &s2, &s3);
+                add_neighbour(below[c - 1], &s0, &s1, &s2, &s3);
+                add_neighbour(below[c], &s0, &s1, &s2, &s3);
+                add_neighbour(below[c + 1], &s0, &s1, &s2, &s3);
+
+                const uint64_t alive = row[c];
+                uint64_t value = 0;
+                for (int i = 0; i < count_total; ++i) {
+                    const int k = counts[i];
+                    const uint64_t match = ((k & 1) ? s0 : ~s0) & ((k & 2) ? s1 : ~s1) & ((k & 4) ? s2 : ~s2) & ((k & 8) ? s3 : ~s3);
+                    value |= match & ((alive & survive[k]) | (~alive & born[k]));
+                }
+
+                changed |= value ^ alive;
+                changed_previous |= value ^ out[c];
+                out[c] = value;
+            }
+        }
+
+        uint64_t *tmp = current;
+        current = next;
+        next = tmp;
+
+        /* Same convergence rules as simulate_generations, evaluated per lane */
+        for (int lane = 0; lane < count; ++lane) {
+            const uint64_t bit = (uint64_t)1 << lane;
+            if (!(active & bit)) {
+                continue;
+            }
+
+            BatchWorld *world = lanes[lane];
+            const uint64_t *final = NULL;
+            if (step == world->generations || (early_exit && !(changed & bit))) {
+                final = current;
+            } else if (early_exit && step > 1 && !(changed_previous & bit)) {
+                final = (world->generations - step) % 2 != 0 ? next : current;
+            }
+
+            if (final) {
+                extract_lane(final, pitch, world, lane);
+                world->computed = step;
+                active &= ~bit;
+            }
+        }
+    }
+
+    free(current);
+    free(next);
+    return 0;
+}
+
+static void *batch_worker(void *arg) {
+    BatchQueue *queue = (BatchQueue *)arg;
+
+    for (;;) {
+        pthread_mutex_lock(&queue->lock);
+        const int index = queue->next_task < queue->task_count ? queue->next_task++ : -1;
+        pthread_mutex_unlock(&queue->lock);
+
+        if (index < 0) {
+            return NULL;
+        }
+
+        const BatchTask *task = &queue->tasks[index];
+        const int status = task->packed ? run_packed(&queue->order[task->first], task->count, queue->early_exit)
+                                        : run_single(queue->order[task->first], queue->early_exit);
+        if (status != 0) {
+            pthread_mutex_lock(&queue->lock);
+            queue->failed = 1;
+            pthread_mutex_unlock(&queue->lock);
+        }
+    }
+}
+
+int simulate_batch(BatchWorld *worlds, int count, int thread_count, int early_exit) {
+    if (count <= 0) {
+        return 0;
+    }
+    if (!worlds || thread_count <= 0) {
+        fprintf(stderr, "Invalid batch arguments\n");
+        return -1;
+    }
+
+    for (int i = 0; i < count; ++i) {
+        if (!worlds[i].grid.cells || worlds[i].grid.rows <= 0 || worlds[i].grid.cols <= 0 || worlds[i].generations < 0) {
+            fprintf(stderr, "Invalid world %d in batch\n", i);
+            return -1;
+        }
+    }
+
+    BatchWorld **order = malloc(sizeof(BatchWorld *) * (size_t)count);
+    BatchTask *tasks = malloc(sizeof(BatchTask) * (size_t)count);
+    pthread_t *threads = calloc((size_t)thread_count, sizeof(pthread_t));
+    if (!order || !tasks || !threads) {
+        fprintf(stderr, "Failed to allocate batch metadata\n");
+        free(order);
+        free(tasks);
+        free(threads);
+        return -1;
+    }
+
+    for (int i = 0; i < count; ++i) {
+        order[i] = &worlds[i];
+    }
+    qsort(order, (size_t)count, sizeof(BatchWorld *), compare_worlds);
+
+    int task_count = 0;
+    for (int i = 0; i < count;) {
+        int group = 1;
+        while (i + group < count && packable(order[i]) && same_pack(order[i], order[i + group])) {
+            ++group;
+        }
+
+        if (packable(order[i]) && group >= BATCH_MIN_PACK) {
+            for (int j = 0; j < group; j += BATCH_LANES) {
+                tasks[task_count++] = (BatchTask){i + j, group - j < BATCH_LANES ? group - j : BATCH_LANES, 1};
+            }
+        } else {
+            for (int j = 0; j < group; ++j) {
+                tasks[task_count++] = (BatchTask){i + j, 1, 0};
+            }
+        }
+        i += group;
+    }
+
+    BatchQueue queue = {order, tasks, task_count, 0, early_exit, 0, PTHREAD_MUTEX_INITIALIZER};
+
+    /* The calling thread works through the queue too */
+    int started = 0;
+    const int helpers = thread_count - 1 < task_count - 1 ? thread_count - 1 : task_count - 1;
+    for (int i = 0; i < helpers; ++i) {
+        if (pthread_create(&threads[started], NULL, batch_worker, &queue) == 0) {
+            ++started;
+        }
+    }
+    batch_worker(&queue);
+
+    for (int i = 0; i < started; ++i) {
+        pthread_join(threads[i], NULL);
+    }
+
+    pthread_mutex_destroy(&queue.lock);
+    free(order);
+    free(tasks);
+    free(threads);
+
+    if (queue.failed) {
+        fprintf(stderr, "Failed to allocate buffers for a batch task\n");
+        return -1;
+    }
+    return 0;
+}
@@ -0,0 +1,537 @@
+#include "include/game_of_life.h"
+
+#include <errno.h>
+#include <mpi.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+/*
+ * Distributed-memory engine: the world is split into a 2D grid of blocks, one
+ * per rank. Each rank keeps its block inside a Grid with a one-cell ghost
+ * frame that is refreshed from the 8 neighbouring ranks every generation.
+ * Block column boundaries fall on multiples of 8 cells so every rank owns
+ * whole bytes of the bit-packed binary format and can read/write its part of
+ * the file directly with MPI-IO.
+ */
+
+enum { NORTH, SOUTH, WEST, EAST, NORTH_WEST, NORTH_EAST, SOUTH_WEST, SOUTH_EAST, DIRECTIONS };
+
+static const int opposite_direction[DIRECTIONS] = {SOUTH, NORTH, EAST, WEST, SOUTH_EAST, SOUTH_WEST, NORTH_EAST, NORTH_WEST};
+
+typedef struct {
+    MPI_Comm comm;
+    int rank;
+    int size;
+    int dims[2];
+    int coords[2];
+    int row_start;
+    int rows;
+    int col_start;
+    int cols;
+    int neighbors[DIRECTIONS];
+} Decomposition;
+
+static void split_range(int total, int parts, int index, int *start_out, int *count_out) {
+    const int base = total / parts;
+    const int remainder = total % parts;
+    *start_out = index * base + (index < remainder ? index : remainder);
+    *count_out = base + (index < remainder ? 1 : 0);
+}
+
+static int neighbor_rank(const Decomposition *dec, int dr, int dc, int periodic) {
+    int coords[2] = {dec->coords[0] + dr, dec->coords[1] + dc};
+
+    for (int d = 0; d < 2; ++d) {
+        if (coords[d] < 0 || coords[d] >= dec->dims[d]) {
+            if (!periodic) {
+                return MPI_PROC_NULL;
+            }
+            coords[d] = (coords[d] + dec->dims[d]) % dec->dims[d];
+        }
+    }
+
+    int rank = MPI_PROC_NULL;
+    MPI_Cart_rank(dec->comm, coords, &rank);
+    return rank;
+}
+
+/*
+ * Picks the process grid from the world's shape rather than MPI_Dims_create's
+ * near-square one: among the factorizations that leave every rank at least
+ * one row and one byte column, the one that cuts the fewest cells (the total
+ * length of the block boundaries, i.e. the halo traffic). A thin world thus
+ * falls back to a 1-D split along its long side. Ties go to more row blocks,
+ * whose rows are contiguous in memory and in the file.
+ */
+static int choose_dims(int size, int rows, int col_units, int cols, int dims[2]) {
+    long best_cut = -1;
+
+    for (int dim_rows = size; dim_rows >= 1; --dim_rows) {
+        if (size % dim_rows != 0) {
+            continue;
+        }
+
+        const int dim_cols = size / dim_rows;
+        if (dim_rows > rows || dim_cols > col_units) {
+            continue;
+        }
+
+        const long cut = (long)(dim_rows - 1) * cols + (long)(dim_cols - 1) * rows;
+        if (best_cut < 0 || cut < best_cut) {
+            best_cut = cut;
+            dims[0] = dim_rows;
+            dims[1] = dim_cols;
+        }
+    }
+
+    return best_cut < 0 ? -1 : 0;
+}
+
+static int create_decomposition(int rows, int cols, int periodic, Decomposition *dec) {
+    int world_size = 0;
+    MPI_Comm_size(MPI_COMM_WORLD, &world_size);
+
+    int dims[2] = {0, 0};
+    int periods[2] = {periodic, periodic};
+    const int col_units = (int)packed_row_bytes(cols);
+    if (choose_dims(world_size, rows, col_units, cols, dims) != 0) {
+        return -1;
+    }
+
+    MPI_Cart_create(MPI_COMM_WORLD, 2, dims, periods, 1, &dec->comm);
+    MPI_Comm_rank(dec->comm, &dec->rank);
+    MPI_Comm_size(dec->comm, &dec->size);
+    MPI_Cart_coords(dec->comm, dec->rank, 2, dec->coords);
+    dec->dims[0] = dims[0];
+    dec->dims[1] = dims[1];
+
+    split_range(rows, dims[0], dec->coords[0], &dec->row_start, &dec->rows);
+
+    int unit_start = 0;
+    int unit_count = 0;
+    split_range(col_units, dims[1], dec->coords[1], &unit_start, &unit_count);
+    dec->col_start = unit_start * 8;
+    const int col_end = (unit_start + unit_count) * 8 < cols ? (unit_start + unit_count) * 8 : cols;
+    dec->cols = col_end - dec->col_start;
+
+    dec->neighbors[NORTH] = neighbor_rank(dec, -1, 0, periodic);
+    dec->neighbors[SOUTH] = neighbor_rank(dec, 1, 0, periodic);
+    dec->neighbors[WEST] = neighbor_rank(dec, 0, -1, periodic);
+    dec->neighbors[EAST] = neighbor_rank(dec, 0, 1, periodic);
+    dec->neighbors[NORTH_WEST] = neighbor_rank(dec, -1, -1, periodic);
+    dec->neighbors[NORTH_EAST] = neighbor_rank(dec, -1, 1, periodic);
+    dec->neighbors[SOUTH_WEST] = neighbor_rank(dec, 1, -1, periodic);
+    dec->neighbors[SOUTH_EAST] = neighbor_rank(dec, 1, 1, periodic);
+    return 0;
+}
+
+static unsigned char *local_cell(const Grid *grid, int row, int col) {
+    return &grid->cells[(size_t)row * (size_t)grid->cols + (size_t)col];
+}
+
+/* Posts the receives into the ghost frame and the sends of the owned border. */
+static void start_halo_exchange(const Decomposition *dec, const Grid *grid, MPI_Datatype row_type, MPI_Datatype col_type, MPI_Request *requests) {
+    const int lr = dec->rows;
+    const int lc = dec->cols;
+
+    struct {
+        MPI_Datatype type;
+        int send_row, send_col;
+        int recv_row, recv_col;
+    } halo[DIRECTIONS] = {
+        [NORTH] = {row_type, 1, 1, 0, 1},
+        [SOUTH] = {row_type, lr, 1, lr + 1, 1},
+        [WEST] = {col_type, 1, 1, 1, 0},
+        [EAST] = {col_type, 1, lc, 1, lc + 1},
+        [NORTH_WEST] = {MPI_UNSIGNED_CHAR, 1, 1, 0, 0},
+        [NORTH_EAST] = {MPI_UNSIGNED_CHAR, 1, lc, 0, lc + 1},
+        [SOUTH_WEST] = {MPI_UNSIGNED_CHAR, lr, 1, lr + 1, 0},
+        [SOUTH_EAST] = {MPI_UNSIGNED_CHAR, lr, lc, lr + 1, lc + 1},
+    };
+
+    for (int d = 0; d < DIRECTIONS; ++d) {
+        MPI_Irecv(local_cell(grid, halo[d].recv_row, halo[d].recv_col), 1, halo[d].type,
+                  dec->neighbors[d], opposite_direction[d], dec->comm, &requests[d]);
+    }
+
+    for (int d = 0; d < DIRECTIONS; ++d) {
+        MPI_Isend(local_cell(grid, halo[d].send_row, halo[d].send_col), 1, halo[d].type,
+                  dec->neighbors[d], d, dec->comm, &requests[DIRECTIONS + d]);
+    }
+}
+
+static void run_generations(const Decomposition *dec, Grid **current, Grid **next, int generations, const LifeRule *rule) {
+    const int lr = dec->rows;
+    const int lc = dec->cols;
+
+    /* Ghost cells make every owned cell an interior cell of the local grid,
+     * so no block reaches its border and none needs a dead row */
+    LifeRule local_rule = *rule;
+    local_rule.wrap = 0;
+
+    MPI_Datatype row_type;
+    MPI_Datatype col_type;
+    MPI_Type_contiguous(lc, MPI_UNSIGNED_CHAR, &row_type);
+    MPI_Type_vector(lr, 1, lc + 2, MPI_UNSIGNED_CHAR, &col_type);
+    MPI_Type_commit(&row_type);
+    MPI_Type_commit(&col_type);
+
+    MPI_Request requests[2 * DIRECTIONS];
+
+    for (int gen = 0; gen < generations; ++gen) {
+        start_halo_exchange(dec, *current, row_type, col_type, requests);
+
+        /* Cells that do not touch the ghost frame overlap with the exchange */
+        step_block(*current, *next, 2, lr, 2, lc, &local_rule, NULL);
+
+        MPI_Waitall(2 * DIRECTIONS, requests, MPI_STATUSES_IGNORE);
+
+        step_block(*current, *next, 1, 2, 1, lc + 1, &local_rule, NULL);
+        if (lr > 1) {
+            step_block(*current, *next, lr, lr + 1, 1, lc + 1, &local_rule, NULL);
+        }
+        step_block(*current, *next, 2, lr, 1, 2, &local_rule, NULL);
+        if (lc > 1) {
+            step_block(*current, *next, 2, lr, lc, lc + 1, &local_rule, NULL);
+        }
+
+        Grid *tmp = *current;
+        *current = *next;
+        *next = tmp;
+    }
+
+    MPI_Type_free(&row_type);
+    MPI_Type_free(&col_type);
+}
+
+/* File view selecting this rank's bytes of the packed rows after the header. */
+static MPI_Datatype block_file_type(const Decomposition *dec, int rows, int cols) {
+    const int sizes[2] = {rows, (int)packed_row_bytes(cols)};
+    const int subsizes[2] = {dec->rows, (int)packed_row_bytes(dec->cols)};
+    const int starts[2] = {dec->row_start, dec->col_start / 8};
+
+    MPI_Datatype type;
+    MPI_Type_create_subarray(2, sizes, subsizes, starts, MPI_ORDER_C, MPI_UNSIGNED_CHAR, &type);
+    MPI_Type_commit(&type);
+    return type;
+}
+
+/* One packed row of the block, so MPI-IO counts rows rather than bytes (a block can exceed INT_MAX bytes). */
+static MPI_Datatype packed_row_type(const Decomposition *dec) {
+    MPI_Datatype type;
+    MPI_Type_contiguous((int)packed_row_bytes(dec->cols), MPI_UNSIGNED_CHAR, &type);
+    MPI_Type_commit(&type);
+    return type;
+}
+
+static int read_binary_block(const char *path, const Decomposition *dec, int rows, int cols, Grid *local) {
+    MPI_File file;
+    if (MPI_File_open(dec->comm, path, MPI_MODE_RDONLY, MPI_INFO_NULL, &file) != MPI_SUCCESS) {
+        return -1;
+    }
+
+    const size_t block_bytes = packed_row_bytes(dec->cols);
+    unsigned char *packed = malloc((size_t)dec->rows * block_bytes);
+    if (!packed) {
+        MPI_File_close(&file);
+        return -1;
+    }
+
+    MPI_Datatype file_type = block_file_type(dec, rows, cols);
+    MPI_Datatype packed_row = packed_row_type(dec);
+    MPI_File_set_view(file, WORLD_BINARY_HEADER_SIZE, MPI_UNSIGNED_CHAR, file_type, "native", MPI_INFO_NULL);
+    const int status = MPI_File_read_all(file, packed, dec->rows, packed_row, MPI_STATUS_IGNORE);
+    MPI_Type_free(&packed_row);
+    MPI_Type_free(&file_type);
+    MPI_File_close(&file);
+
+    for (int r = 0; r < dec->rows; ++r) {
+        unpack_cells(packed + (size_t)r * block_bytes, dec->cols, local_cell(local, r + 1, 1));
+    }
+
+    free(packed);
+    return status == MPI_SUCCESS ? 0 : -1;
+}
+
+static int write_binary_block(const char *path, const Decomposition *dec, int generations, int rows, int cols, const LifeRule *rule, const Grid *local) {
+    if (dec->rank == 0) {
+        MPI_File_delete(path, MPI_INFO_NULL);
+    }
+    MPI_Barrier(dec->comm);
+
+    MPI_File file;
+    if (MPI_File_open(dec->comm, path, MPI_MODE_CREATE | MPI_MODE_WRONLY, MPI_INFO_NULL, &file) != MPI_SUCCESS) {
+        return -1;
+    }
+
+    int failed = 0;
+    if (dec->rank == 0) {
+        unsigned char header[WORLD_BINARY_HEADER_SIZE];
+        encode_binary_header(header, generations, 0, rows, cols, rule);
+        failed |= MPI_File_write_at(file, 0, header, WORLD_BINARY_HEADER_SIZE, MPI_UNSIGNED_CHAR, MPI_STATUS_IGNORE) != MPI_SUCCESS;
+    }
+
+    const size_t block_bytes = packed_row_bytes(dec->cols);
+    unsigned char *packed = malloc((size_t)dec->rows * block_bytes);
+    if (!packed) {
+        MPI_File_close(&file);
+        return -1;
+    }
+
+    for (int r = 0; r < dec->rows; ++r) {
+        pack_cells(local_cell(local, r + 1, 1), dec->cols, packed + (size_t)r * block_bytes);
+    }
+
+    MPI_Datatype file_type = block_file_type(dec, rows, cols);
+    MPI_Datatype packed_row = packed_row_type(dec);
+    MPI_File_set_view(file, WORLD_BINARY_HEADER_SIZE, MPI_UNSIGNED_CHAR, file_type, "native", MPI_INFO_NULL);
+    failed |= MPI_File_write_all(file, packed, dec->rows, packed_row, MPI_STATUS_IGNORE) != MPI_SUCCESS;
+    MPI_Type_free(&packed_row);
+    MPI_Type_free(&file_type);
+    MPI_File_close(&file);
+
+    free(packed);
+    return failed ? -1 : 0;
+}
+
+/*
+ * Rank 0 inspects the input. Binary worlds are then read in parallel, each
+ * rank fetching only its block; text and RLE worlds are parsed by rank 0
+ * alone into *world and scattered once the decomposition is known.
+ * A rule recorded by the file is broadcast into *rule (if not NULL).
+ */
+static int read_world_input(const char *path, int *is_binary, int *generations, int *rows, int *cols, LifeRule *rule, Grid *world) {
+    int header_info[5] = {-1, 0, 0, 0, 0};
+    int rank = 0;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+    if (rank == 0) {
+        FILE *file = fopen(path, "rb");
+        unsigned char header[WORLD_BINARY_HEADER_SIZE];
+        int generation = 0;
+
+        if (!file) {
+            fprintf(stderr, "Failed to open %s: %s\n", path, strerror(errno));
+        } else {
+            const int binary = fread(header, 1, sizeof(header), file) == sizeof(header) && memcmp(header, "GOLB", 4) == 0;
+            fclose(file);
+
+            if (binary) {
+                if (decode_binary_header(header, path, &header_info[2], &generation, &header_info[3], &header_info[4], rule) == 0) {
+                    header_info[0] = 0;
+                    header_info[1] = 1;
+                }
+            } else if (load_world_from_file(path, &header_info[2], world, rule) == 0) {
+                header_info[0] = 0;
+                header_info[3] = world->rows;
+                header_info[4] = world->cols;
+            }
+        }
+    }
+
+    MPI_Bcast(header_info, 5, MPI_INT, 0, MPI_COMM_WORLD);
+    if (rule) {
+        MPI_Bcast(rule, (int)sizeof(*rule), MPI_BYTE, 0, MPI_COMM_WORLD);
+    }
+    *is_binary = header_info[1];
+    *generations = header_info[2];
+    *rows = header_info[3];
+    *cols = header_info[4];
+    return header_info[0];
+}
+
+/*
+ * Sends every rank its block of the world parsed by rank 0 of MPI_COMM_WORLD
+ * (whose rank in the Cartesian communicator may differ). Each block lands in
+ * the interior of the receiver's local grid.
+ */
+static void scatter_world(const Decomposition *dec, const Grid *world, Grid *local) {
+    int world_rank = 0;
+    int world_size = 0;
+    MPI_Comm_rank(MPI_COMM_WORLD, &world_rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &world_size);
+
+    const int block[4] = {dec->row_start, dec->rows, dec->col_start, dec->cols};
+    int *blocks = NULL;
+    if (world_rank == 0) {
+        blocks = malloc((size_t)world_size * sizeof(block));
+        if (!blocks) {
+            fprintf(stderr, "Failed to allocate the block table\n");
+            MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+        }
+    }
+    MPI_Gather(block, 4, MPI_INT, blocks, 4, MPI_INT, 0, MPI_COMM_WORLD);
+
+    if (world_rank != 0) {
+        MPI_Datatype interior;
+        MPI_Type_vector(dec->rows, dec->cols, dec->cols + 2, MPI_UNSIGNED_CHAR, &interior);
+        MPI_Type_commit(&interior);
+        MPI_Recv(local_cell(local, 1, 1), 1, interior, 0, 0, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+        MPI_Type_free(&interior);
+        return;
+    }
+
+    const int sizes[2] = {world->rows, world->cols};
+    for (int r = 1; r < world_size; ++r) {
+        const int subsizes[2] = {blocks[4 * r + 1], blocks[4 * r + 3]};
+        const int starts[2] = {blocks[4 * r], blocks[4 * r + 2]};
+
+        MPI_Datatype type;
+        MPI_Type_create_subarray(2, sizes, subsizes, starts, MPI_ORDER_C, MPI_UNSIGNED_CHAR, &type);
+        MPI_Type_commit(&type);
+        MPI_Send(world->cells, 1, type, r, 0, MPI_COMM_WORLD);
+        MPI_Type_free(&type);
+    }
+
+    for (int r = 0; r < dec->rows; ++r) {
+        memcpy(local_cell(local, r + 1, 1),
+               &world->cells[(size_t)(dec->row_start + r) * (size_t)world->cols + (size_t)dec->col_start],
+               (size_t)dec->cols);
+    }
+    free(blocks);
+}
+
+int main(int argc, char **argv) {
+    MPI_Init(&argc, &argv);
+
+    int world_rank = 0;
+    int world_size = 0;
+    MPI_Comm_rank(MPI_COMM_WORLD, &world_rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &world_size);
+
+    if (argc < 2) {
+        if (world_rank == 0) {
+            fprintf(stderr, "Usage: %s <input_file> [--rule B3/S23] [--wrap]\n", argv[0]);
+        }
+        MPI_Finalize();
+        return EXIT_FAILURE;
+    }
+
+    const char *input_path = argv[1];
+    LifeRule rule;
+    life_rule_default(&rule);
+    int rule_given = 0;
+    int wrap_given = 0;
+
+    for (int i = 2; i < argc; ++i) {
+        if (strcmp(argv[i], "--rule") == 0 && i + 1 < argc) {
+            const char *rule_spec = argv[++i];
+            if (parse_life_rule(rule_spec, &rule) != 0) {
+                if (world_rank == 0) {
+                    fprintf(stderr, "Invalid rule (expected B/S notation, e.g. B36/S23): %s\n", rule_spec);
+                }
+                MPI_Finalize();
+                return EXIT_FAILURE;
+            }
+            rule_given = 1;
+        } else if (strcmp(argv[i], "--wrap") == 0) {
+            wrap_given = 1;
+        } else {
+            if (world_rank == 0) {
+                fprintf(stderr, "Unknown option: %s\n", argv[i]);
+            }
+            MPI_Finalize();
+            return EXIT_FAILURE;
+        }
+    }
+
+    int is_binary = 0;
+    int generations = 0;
+    int rows = 0;
+    int cols = 0;
+    Grid world = {0};
+
+    if (read_world_input(input_path, &is_binary, &generations, &rows, &cols, rule_given ? NULL : &rule, &world) != 0) {
+        MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+    }
+
+    /* Without --rule, a rule named by the input file applies; --wrap only changes the borders */
+    if (wrap_given) {
+        rule.wrap = 1;
+    }
+
+    Decomposition dec;
+    if (create_decomposition(rows, cols, rule.wrap, &dec) != 0) {
+        if (world_rank == 0) {
+            fprintf(stderr, "Too many processes (%d) for a %dx%d world\n", world_size, rows, cols);
+        }
+        MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+    }
+
+    Grid local = allocate_grid(dec.rows + 2, dec.cols + 2);
+    Grid buffer = allocate_grid(dec.rows + 2, dec.cols + 2);
+    if (!local.cells || !buffer.cells) {
+        fprintf(stderr, "Rank %d failed to allocate a %dx%d block\n", dec.rank, dec.rows, dec.cols);
+        MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+    }
+
+    if (is_binary) {
+        if (read_binary_block(input_path, &dec, rows, cols, &local) != 0) {
+            fprintf(stderr, "Rank %d failed to read its block of %s\n", dec.rank, input_path);
+            MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+        }
+    } else {
+        scatter_world(&dec, &world, &local);
+        free_grid(&world);
+    }
+
+    Grid *current = &local;
+    Grid *next = &buffer;
+
+    MPI_Barrier(dec.comm);
+    const double start_time = MPI_Wtime();
+
+    run_generations(&dec, &current, &next, generations, &rule);
+
+    const double local_elapsed = MPI_Wtime() - start_time;
+
+    int dir_status = 0;
+    if (dec.rank == 0 && mkdir("output", 0755) != 0 && errno != EEXIST) {
+        fprintf(stderr, "Failed to create output directory: %s\n", strerror(errno));
+        dir_status = -1;
+    }
+    MPI_Bcast(&dir_status, 1, MPI_INT, 0, dec.comm);
+    if (dir_status != 0) {
+        MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+    }
+
+    char output_path[160];
+    snprintf(output_path, sizeof(output_path), "output/game_of_life_mpi_%dp_%dx%d_%dgen.bin", dec.size, rows, cols, generations);
+
+    if (write_binary_block(output_path, &dec, generations, rows, cols, &rule, current) != 0) {
+        fprintf(stderr, "Rank %d failed to write its block to %s\n", dec.rank, output_path);
+        MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+    }
+
+    double elapsed = 0.0;
+    const long local_peak_kb = get_peak_rss_kb();
+    long peak_kb = 0;
+    long total_kb = 0;
+    MPI_Reduce(&local_elapsed, &elapsed, 1, MPI_DOUBLE, MPI_MAX, 0, dec.comm);
+    MPI_Reduce(&local_peak_kb, &peak_kb, 1, MPI_LONG, MPI_MAX, 0, dec.comm);
+    MPI_Reduce(&local_peak_kb, &total_kb, 1, MPI_LONG, MPI_SUM, 0, dec.comm);
+
+    if (dec.rank == 0) {
+        char rule_spec[LIFE_RULE_SPEC_SIZE];
+        format_life_rule(&rule, rule_spec, sizeof(rule_spec));
+        printf("[MPI] Using %d ranks (%dx%d blocks)\n", dec.size, dec.dims[0], dec.dims[1]);
+        printf("[MPI] Rule: %s (%s borders)\n", rule_spec, rule.wrap ? "toroidal" : "dead");
+        printf("[MPI] Execution time: %.6f seconds\n", elapsed);
+        if (elapsed > 0.0) {
+            printf("[MPI] Throughput: %.3e cell updates/s\n", (double)rows * (double)cols * (double)generations / elapsed);
+        }
+        if (peak_kb >= 0) {
+            printf("[MPI] Peak memory: %ld KB per rank (max), %ld KB total\n", peak_kb, total_kb);
+        }
+        printf("[MPI] Output written to %s\n", output_path);
+    }
+
+    free_grid(current);
+    free_grid(next);
+    MPI_Comm_free(&dec.comm);
+
+    MPI_Finalize();
+    return EXIT_SUCCESS;
+}
@@ -1,7 +1,12 @@
+/* pthread_attr_setaffinity_np and the CPU_* macros are GNU extensions */
+#define _GNU_SOURCE
+
 #include "include/game_of_life.h"
 
 #include <errno.h>
 #include <pthread.h>
+#include <sched.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -14,41 +19,523 @@ static double elapsed_seconds(const struct timespec *start, const struct timespe
     return (double)sec + (double)nsec / 1e9;
 }
 
+static uint64_t monotonic_ns(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000u + (uint64_t)now.tv_nsec;
+}
+
+/*
+ * Per-thread phase timers. Every generation a worker goes through: compute
+ * its strip, wait at compute_barrier, wait at swap_barrier (thread 0 swaps the
+ * grids meanwhile) and optionally copy its strip for a checkpoint. The totals
+ * are always kept; with --trace the phase boundaries of every generation are
+ * recorded as well and exported as Chrome trace events.
+ */
+enum { MARK_START, MARK_COMPUTED, MARK_COMPUTE_SYNC, MARK_SWAP_SYNC, MARK_END, MARKS_PER_GENERATION };
+
+typedef struct {
+    uint64_t compute_ns;
+    uint64_t compute_wait_ns;
+    uint64_t swap_wait_ns;
+    uint64_t checkpoint_ns;
+    uint64_t *marks;
+} ThreadProfile;
+
+static void profile_generation(ThreadProfile *profile, int index, const uint64_t *marks) {
+    profile->compute_ns += marks[MARK_COMPUTED] - marks[MARK_START];
+    profile->compute_wait_ns += marks[MARK_COMPUTE_SYNC] - marks[MARK_COMPUTED];
+    profile->swap_wait_ns += marks[MARK_SWAP_SYNC] - marks[MARK_COMPUTE_SYNC];
+    profile->checkpoint_ns += marks[MARK_END] - marks[MARK_SWAP_SYNC];
+
+    if (profile->marks) {
+        memcpy(&profile->marks[(size_t)index * MARKS_PER_GENERATION], marks, sizeof(uint64_t) * MARKS_PER_GENERATION);
+    }
+}
+
+static void report_profiles(const ThreadProfile *profiles, int thread_count, int per_thread) {
+    double compute_sum = 0.0;
+    double compute_max = 0.0;
+    double wait_sum = 0.0;
+
+    for (int i = 0; i < thread_count; ++i) {
+        const double compute = (double)profiles[i].compute_ns / 1e9;
+        const double wait = (double)(profiles[i].compute_wait_ns + profiles[i].swap_wait_ns) / 1e9;
+        compute_sum += compute;
+        wait_sum += wait;
+        compute_max = compute > compute_max ? compute : compute_max;
+
+        if (per_thread) {
+            printf("[Threads]   thread %2d: compute %.6f s, compute barrier %.6f s, swap barrier %.6f s, checkpoint copy %.6f s\n",
+                   i, compute, (double)profiles[i].compute_wait_ns / 1e9,
+                   (double)profiles[i].swap_wait_ns / 1e9, (double)profiles[i].checkpoint_ns / 1e9);
+        }
+    }
+
+    const double compute_avg = compute_sum / thread_count;
+    printf("[Threads] Compute: avg %.6f s, max %.6f s per thread (imbalance %.3f)\n",
+           compute_avg, compute_max, compute_avg > 0.0 ? compute_max / compute_avg : 1.0);
+    printf("[Threads] Barrier wait: avg %.6f s per thread\n", wait_sum / thread_count);
+}
+
+static void free_profiles(ThreadProfile *profiles, int thread_count) {
+    for (int i = 0; profiles && i < thread_count; ++i) {
+        free(profiles[i].marks);
+    }
+    free(profiles);
+}
+
+static void trace_event(FILE *out, int *first, const char *name, int tid, int gen, uint64_t begin, uint64_t end, uint64_t origin) {
+    if (end <= begin) {
+        return;
+    }
+
+    fprintf(out, "%s\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":0,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f,\"args\":{\"generation\":%d}}",
+            *first ? "" : ",", name, tid, (double)(begin - origin) / 1e3, (double)(end - begin) / 1e3, gen);
+    *first = 0;
+}
+
+static int write_trace(const char *path, const ThreadProfile *profiles, int thread_count, int first_generation, int count) {
+    FILE *out = fopen(path, "w");
+    if (!out) {
+        fprintf(stderr, "Failed to open %s for writing: %s\n", path, strerror(errno));
+        return -1;
+    }
+
+    uint64_t origin = UINT64_MAX;
+    for (int t = 0; t < thread_count && count > 0; ++t) {
+        origin = profiles[t].marks[MARK_START] < origin ? profiles[t].marks[MARK_START] : origin;
+    }
+    int first = 1;
+
+    fprintf(out, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+    for (int t = 0; t < thread_count; ++t) {
+        fprintf(out, "%s\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":%d,\"args\":{\"name\":\"worker %d\"}}",
+                first ? "" : ",", t, t);
+        first = 0;
+
+        for (int g = 0; g < count; ++g) {
+            const uint64_t *marks = &profiles[t].marks[(size_t)g * MARKS_PER_GENERATION];
+            const int gen = first_generation + g;
+            trace_event(out, &first, "compute", t, gen, marks[MARK_START], marks[MARK_COMPUTED], origin);
+            trace_event(out, &first, "compute_barrier", t, gen, marks[MARK_COMPUTED], marks[MARK_COMPUTE_SYNC], origin);
+            trace_event(out, &first, "swap_barrier", t, gen, marks[MARK_COMPUTE_SYNC], marks[MARK_SWAP_SYNC], origin);
+            trace_event(out, &first, "checkpoint_copy", t, gen, marks[MARK_SWAP_SYNC], marks[MARK_END], origin);
+        }
+    }
+    fprintf(out, "\n]}\n");
+
+    return fclose(out) == 0 ? 0 : -1;
+}
+
+/*
+ * Asynchronous checkpointing: at every checkpoint generation the workers copy
+ * their own strip of the freshly computed grid into `staging`, and the last one
+ * to finish hands it to a dedicated writer thread. Workers only block if the
+ * writer is still busy with the previous snapshot when the next one is due.
+ */
+typedef struct {
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    pthread_t thread;
+    Grid staging;
+    const char *path;
+    const LifeRule *rule;
+    int every;
+    int generations;
+    int thread_count;
+    int copied;
+    int pending;
+    int staged_generation;
+    int stop;
+    int failed;
+    int written;
+    double copy_seconds;
+    double stall_seconds;
+    double write_seconds;
+} Checkpointer;
+
+static int write_checkpoint_file(const Checkpointer *ckpt) {
+    char tmp_path[200];
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", ckpt->path);
+
+    FILE *out = fopen(tmp_path, "wb");
+    if (!out) {
+        fprintf(stderr, "Failed to open %s for writing: %s\n", tmp_path, strerror(errno));
+        return -1;
+    }
+
+    const int status = write_snapshot(out, ckpt->generations, ckpt->staged_generation, &ckpt->staging, ckpt->rule);
+    if (fclose(out) != 0 || status != 0) {
+        fprintf(stderr, "Failed to write checkpoint %s\n", tmp_path);
+        remove(tmp_path);
+        return -1;
+    }
+
+    /* rename() is atomic, so a crash mid-write never clobbers the last good checkpoint */
+    if (rename(tmp_path, ckpt->path) != 0) {
+        fprintf(stderr, "Failed to publish checkpoint %s: %s\n", ckpt->path, strerror(errno));
+        return -1;
+    }
+
+    return 0;
+}
+
+static void *checkpoint_writer(void *arg) {
+    Checkpointer *ckpt = (Checkpointer *)arg;
+
+    pthread_mutex_lock(&ckpt->lock);
+    for (;;) {
+        while (!ckpt->pending && !ckpt->stop) {
+            pthread_cond_wait(&ckpt->cond, &ckpt->lock);
+        }
+
+        if (!ckpt->pending) {
+            break;
+        }
+
+        pthread_mutex_unlock(&ckpt->lock);
+
+        struct timespec start_time = {0};
+        struct timespec end_time = {0};
+        clock_gettime(CLOCK_MONOTONIC, &start_time);
+        const int status = write_checkpoint_file(ckpt);
+        clock_gettime(CLOCK_MONOTONIC, &end_time);
+
+        pthread_mutex_lock(&ckpt->lock);
+        ckpt->write_seconds += elapsed_seconds(&start_time, &end_time);
+        ckpt->failed |= status != 0;
+        ckpt->written += status == 0 ? 1 : 0;
+        ckpt->pending = 0;
+        pthread_cond_broadcast(&ckpt->cond);
+    }
+    pthread_mutex_unlock(&ckpt->lock);
+
+    return NULL;
+}
+
+static int checkpointer_start(Checkpointer *ckpt, const char *path, const LifeRule *rule, int every, int generations, int thread_count, int rows, int cols) {
+    memset(ckpt, 0, sizeof(*ckpt));
+    ckpt->path = path;
+    ckpt->rule = rule;
+    ckpt->every = every;
+    ckpt->generations = generations;
+    ckpt->thread_count = thread_count;
+
+    ckpt->staging = allocate_grid(rows, cols);
+    if (!ckpt->staging.cells) {
+        fprintf(stderr, "Failed to allocate checkpoint staging buffer\n");
+        return -1;
+    }
+
+    pthread_mutex_init(&ckpt->lock, NULL);
+    pthread_cond_init(&ckpt->cond, NULL);
+
+    if (pthread_create(&ckpt->thread, NULL, checkpoint_writer, ckpt) != 0) {
+        fprintf(stderr, "Failed to create checkpoint writer thread\n");
+        pthread_mutex_destroy(&ckpt->lock);
+        pthread_cond_destroy(&ckpt->cond);
+        free_grid(&ckpt->staging);
+        return -1;
+    }
+
+    return 0;
+}
+
+static void checkpointer_stop(Checkpointer *ckpt) {
+    pthread_mutex_lock(&ckpt->lock);
+    ckpt->stop = 1;
+    pthread_cond_broadcast(&ckpt->cond);
+    pthread_mutex_unlock(&ckpt->lock);
+
+    pthread_join(ckpt->thread, NULL);
+
+    pthread_mutex_destroy(&ckpt->lock);
+    pthread_cond_destroy(&ckpt->cond);
+    free_grid(&ckpt->staging);
+}
+
+static int checkpoint_due(const Checkpointer *ckpt, int completed) {
+    return ckpt && completed % ckpt->every == 0 && completed < ckpt->generations;
+}
+
+/* Called by thread 0 between the barriers: make sure the staging buffer is free. */
+static void checkpoint_reserve(Checkpointer *ckpt) {
+    struct timespec start_time = {0};
+    struct timespec end_time = {0};
+    clock_gettime(CLOCK_MONOTONIC, &start_time);
+
+    pthread_mutex_lock(&ckpt->lock);
+    while (ckpt->pending) {
+        pthread_cond_wait(&ckpt->cond, &ckpt->lock);
+    }
+    ckpt->copied = 0;
+    pthread_mutex_unlock(&ckpt->lock);
+
+    clock_gettime(CLOCK_MONOTONIC, &end_time);
+    ckpt->stall_seconds += elapsed_seconds(&start_time, &end_time);
+}
+
+static void checkpoint_copy_strip(Checkpointer *ckpt, const Grid *grid, int start_row, int end_row, int completed) {
+    struct timespec start_time = {0};
+    struct timespec end_time = {0};
+    clock_gettime(CLOCK_MONOTONIC, &start_time);
+
+    const size_t offset = (size_t)start_row * (size_t)grid->cols;
+    const size_t bytes = (size_t)(end_row - start_row) * (size_t)grid->cols;
+    memcpy(ckpt->staging.cells + offset, grid->cells + offset, bytes);
+
+    clock_gettime(CLOCK_MONOTONIC, &end_time);
+
+    pthread_mutex_lock(&ckpt->lock);
+    ckpt->copy_seconds += elapsed_seconds(&start_time, &end_time);
+    if (++ckpt->copied == ckpt->thread_count) {
+        ckpt->staged_generation = completed;
+        ckpt->pending = 1;
+        pthread_cond_broadcast(&ckpt->cond);
+    }
+    pthread_mutex_unlock(&ckpt->lock);
+}
+
+/*
+ * Where worker threads run and where their rows live. With pin, strip i is
+ * always handled on the same CPU, both when its pages are first touched and
+ * when worker i steps it, so on NUMA machines each strip stays node-local.
+ */
+typedef struct {
+    int thread_count;
+    int pin;
+    int hugepages;
+    int cpu_count;
+    int cpus[CPU_SETSIZE];
+} Placement;
+
+static int placement_init(Placement *placement, int thread_count, int pin, int hugepages) {
+    memset(placement, 0, sizeof(*placement));
+    placement->thread_count = thread_count;
+    placement->pin = pin;
+    placement->hugepages = hugepages;
+
+    if (!pin) {
+        return 0;
+    }
+
+    cpu_set_t allowed;
+    CPU_ZERO(&allowed);
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0) {
+        fprintf(stderr, "Failed to query CPU affinity: %s\n", strerror(errno));
+        return -1;
+    }
+
+    for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+        if (CPU_ISSET(cpu, &allowed)) {
+            placement->cpus[placement->cpu_count++] = cpu;
+        }
+    }
+
+    return placement->cpu_count > 0 ? 0 : -1;
+}
+
+static void strip_bounds(int rows, int thread_count, int index, int *start_out, int *end_out) {
+    const int base_rows = rows / thread_count;
+    const int remainder = rows % thread_count;
+    *start_out = index * base_rows + (index < remainder ? index : remainder);
+    *end_out = *start_out + base_rows + (index < remainder ? 1 : 0);
+}
+
+static int start_thread(pthread_t *thread, const Placement *placement, int index, void *(*routine)(void *), void *arg) {
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+
+    if (placement->pin) {
+        cpu_set_t cpus;
+        CPU_ZERO(&cpus);
+        CPU_SET(placement->cpus[index % placement->cpu_count], &cpus);
+        pthread_attr_setaffinity_np(&attr, sizeof(cpus), &cpus);
+    }
+
+    const int status = pthread_create(thread, &attr, routine, arg);
+    pthread_attr_destroy(&attr);
+    return status;
+}
+
+typedef struct {
+    Grid *grid;
+    int start_row;
+    int end_row;
+} TouchArgs;
+
+static void *touch_strip(void *arg) {
+    TouchArgs *data = (TouchArgs *)arg;
+    const size_t cols = (size_t)data->grid->cols;
+    memset(data->grid->cells + (size_t)data->start_row * cols, 0, (size_t)(data->end_row - data->start_row) * cols);
+    return NULL;
+}
+
+/*
+ * GridAllocator: maps the grid untouched and, with pin, lets a thread on each
+ * worker's CPU zero that worker's strip. Unpinned, the short-lived touching
+ * threads and the workers may land on different nodes, so the pages are left
+ * to whichever thread writes them first.
+ */
+static Grid allocate_first_touch(int rows, int cols, void *context) {
+    const Placement *placement = (const Placement *)context;
+    Grid grid = allocate_grid_untouched(rows, cols, placement->hugepages);
+    if (!grid.cells || !placement->pin) {
+        return grid;
+    }
+
+    pthread_t *threads = calloc((size_t)placement->thread_count, sizeof(pthread_t));
+    TouchArgs *args = calloc((size_t)placement->thread_count, sizeof(TouchArgs));
+    if (!threads || !args) {
+        free(threads);
+        free(args);
+        free_grid(&grid);
+        return grid;
+    }
+
+    int started = 0;
+    for (int i = 0; i < placement->thread_count; ++i) {
+        args[i].grid = &grid;
+        strip_bounds(rows, placement->thread_count, i, &args[i].start_row, &args[i].end_row);
+
+        if (start_thread(&threads[i], placement, i, touch_strip, &args[i]) != 0) {
+            touch_strip(&args[i]);
+            continue;
+        }
+        threads[started++] = threads[i];
+    }
+
+    for (int i = 0; i < started; ++i) {
+        pthread_join(threads[i], NULL);
+    }
+
+    free(threads);
+    free(args);
+    return grid;
+}
+
+/*
+ * Early termination: every worker publishes the STEP_* flags of its strip and
+ * thread 0 combines them between the barriers. A grid that did not change is
+ * a still life; one that equals the generation before it (still sitting in
+ * the other buffer) is a period-2 oscillator, and the final generation is
+ * whichever of the two buffers has the right parity.
+ */
+typedef struct {
+    int enabled;
+    int *flags;
+    int computed;
+    int period;
+} Convergence;
+
+static void convergence_update(Convergence *conv, int thread_count, int remaining, Grid **current, Grid **next) {
+    conv->computed++;
+    if (!conv->enabled) {
+        return;
+    }
+
+    int flags = 0;
+    for (int i = 0; i < thread_count; ++i) {
+        flags |= conv->flags[i];
+    }
+
+    /* The other buffer holds no earlier generation after the first step of a run */
+    if (!(flags & STEP_CHANGED)) {
+        conv->period = 1;
+    } else if (conv->computed > 1 && !(flags & STEP_CHANGED_FROM_PREVIOUS)) {
+        conv->period = 2;
+        if (remaining % 2 != 0) {
+            Grid *tmp = *current;
+            *current = *next;
+            *next = tmp;
+        }
+    }
+}
+
 typedef struct {
     int thread_id;
+    int thread_count;
     int start_row;
     int end_row;
+    int first_generation;
     int generations;
     Grid **current;
     Grid **next;
     pthread_barrier_t *compute_barrier;
     pthread_barrier_t *swap_barrier;
+    Checkpointer *checkpointer;
+    Convergence *convergence;
+    RowCache *cache;
+    const unsigned char *dead_row;
+    const LifeRule *rule;
+    ThreadProfile *profile;
 } WorkerArgs;
 
 static void *worker(void *arg) {
     WorkerArgs *data = (WorkerArgs *)arg;
 
-    for (int gen = 0; gen < data->generations; ++gen) {
+    /*
+     * In place, a strip overwrites its own rows, so the neighbouring rows it
+     * reads must be saved while the whole grid still holds the old generation:
+     * once before the first step and then between the two barriers.
+     */
+    if (data->cache) {
+        row_cache_save_halo(data->cache, *data->current, data->start_row, data->end_row, data->rule);
+        pthread_barrier_wait(data->swap_barrier);
+    }
+
+    for (int gen = data->first_generation; gen < data->generations; ++gen) {
         Grid *current = *data->current;
         Grid *next = *data->next;
+        const int snapshot = checkpoint_due(data->checkpointer, gen + 1);
+        uint64_t marks[MARKS_PER_GENERATION];
 
-        step_range(current, next, data->start_row, data->end_row);
+        marks[MARK_START] = monotonic_ns();
+        data->convergence->flags[data->thread_id] = data->cache
+            ? step_range_in_place(current, data->start_row, data->end_row, data->cache, data->rule)
+            : step_range_rule(current, next, data->start_row, data->end_row, data->rule, data->dead_row);
+        marks[MARK_COMPUTED] = monotonic_ns();
 
         pthread_barrier_wait(data->compute_barrier);
+        marks[MARK_COMPUTE_SYNC] = monotonic_ns();
+
+        if (data->cache) {
+            row_cache_save_halo(data->cache, current, data->start_row, data->end_row, data->rule);
+        }
 
         if (data->thread_id == 0) {
             Grid *tmp = *data->current;
             *data->current = *data->next;
             *data->next = tmp;
+
+            convergence_update(data->convergence, data->thread_count, data->generations - gen - 1, data->current, data->next);
+            if (snapshot && !data->convergence->period) {
+                checkpoint_reserve(data->checkpointer);
+            }
         }
 
         pthread_barrier_wait(data->swap_barrier);
+        marks[MARK_SWAP_SYNC] = monotonic_ns();
+
+        /* The run ends here once converged, so there is nothing to checkpoint */
+        const int converged = data->convergence->period != 0;
+        if (snapshot && !converged) {
+            checkpoint_copy_strip(data->checkpointer, *data->current, data->start_row, data->end_row, gen + 1);
+        }
+        marks[MARK_END] = snapshot && !converged ? monotonic_ns() : marks[MARK_SWAP_SYNC];
+
+        profile_generation(data->profile, gen - data->first_generation, marks);
+        if (converged) {
+            break;
+        }
     }
 
     return NULL;
 }
 
-static int create_workers(int thread_count, int generations, Grid **current, Grid **next) {
+static int create_workers(const Placement *placement, int first_generation, int generations, Grid **current, Grid **next, const LifeRule *rule, Checkpointer *checkpointer, Convergence *convergence, RowCache *caches, const unsigned char *dead_row, ThreadProfile *profiles) {
+    const int thread_count = placement->thread_count;
     pthread_t *threads = calloc((size_t)thread_count, sizeof(pthread_t));
     WorkerArgs *args = calloc((size_t)thread_count, sizeof(WorkerArgs));
     pthread_barrier_t compute_barrier;
@@ -69,27 +556,24 @@ static int create_workers(int thread_count, int generations, Grid **current, Gri
         return -1;
     }
 
-    const int rows = (*current)->rows;
-    const int base_rows = rows / thread_count;
-    int remainder = rows % thread_count;
-    int start = 0;
-
     for (int i = 0; i < thread_count; ++i) {
-        int count = base_rows + (remainder > 0 ? 1 : 0);
-        remainder = remainder > 0 ? remainder - 1 : 0;
-
         args[i].thread_id = i;
-        args[i].start_row = start;
-        args[i].end_row = start + count;
+        args[i].thread_count = thread_count;
+        strip_bounds((*current)->rows, thread_count, i, &args[i].start_row, &args[i].end_row);
+        args[i].first_generation = first_generation;
         args[i].generations = generations;
         args[i].current = current;
         args[i].next = next;
         args[i].compute_barrier = &compute_barrier;
         args[i].swap_barrier = &swap_barrier;
-
-        start += count;
-
-        if (pthread_create(&threads[i], NULL, worker, &args[i]) != 0) {
+        args[i].checkpointer = checkpointer;
+        args[i].convergence = convergence;
+        args[i].cache = caches ? &caches[i] : NULL;
+        args[i].dead_row = dead_row;
+        args[i].rule = rule;
+        args[i].profile = &profiles[i];
+
+        if (start_thread(&threads[i], placement, i, worker, &args[i]) != 0) {
             fprintf(stderr, "Failed to create thread %d\n", i);
             for (int j = 0; j < i; ++j) {
                 pthread_join(threads[j], NULL);
@@ -114,73 +598,242 @@ static int create_workers(int thread_count, int generations, Grid **current, Gri
     return 0;
 }
 
+static void free_row_caches(RowCache *caches, int thread_count) {
+    for (int i = 0; caches && i < thread_count; ++i) {
+        row_cache_free(&caches[i]);
+    }
+    free(caches);
+}
+
+static void checkpoint_path_for(const char *input_path, char *path, size_t size) {
+    const char *base = strrchr(input_path, '/');
+    base = base ? base + 1 : input_path;
+
+    const char *dot = strrchr(base, '.');
+    const int stem_len = dot && dot != base ? (int)(dot - base) : (int)strlen(base);
+
+    snprintf(path, size, "output/checkpoint_%.*s.bin", stem_len, base);
+}
+
 int main(int argc, char **argv) {
     if (argc < 3) {
-        fprintf(stderr, "Usage: %s <input_file> <num_threads>\n", argv[0]);
+        fprintf(stderr, "Usage: %s <input_file> <num_threads> [--format text|rle|bin] [--rule B3/S23] [--wrap] [--checkpoint-every K] [--resume] [--pin] [--hugepages] [--profile] [--trace FILE] [--no-early-exit] [--in-place]\n", argv[0]);
         return EXIT_FAILURE;
     }
 
     const char *input_path = argv[1];
     const int thread_count = atoi(argv[2]);
+    WorldFormat output_format = WORLD_FORMAT_TEXT;
+    LifeRule rule;
+    life_rule_default(&rule);
+    int rule_given = 0;
+    int wrap_given = 0;
+    int checkpoint_every = 0;
+    int resume = 0;
+    int pin = 0;
+    int hugepages = 0;
+    int profile_threads = 0;
+    const char *trace_path = NULL;
+    int early_exit = 1;
+    int in_place = 0;
 
     if (thread_count <= 0) {
         fprintf(stderr, "Number of threads must be a positive integer\n");
         return EXIT_FAILURE;
     }
 
+    for (int i = 3; i < argc; ++i) {
+        if (strcmp(argv[i], "--format") == 0 && i + 1 < argc) {
+            if (parse_world_format(argv[++i], &output_format) != 0) {
+                fprintf(stderr, "Unknown output format: %s\n", argv[i]);
+                return EXIT_FAILURE;
+            }
+        } else if (strcmp(argv[i], "--checkpoint-every") == 0 && i + 1 < argc) {
+            checkpoint_every = atoi(argv[++i]);
+            if (checkpoint_every <= 0) {
+                fprintf(stderr, "Checkpoint interval must be a positive integer\n");
+                return EXIT_FAILURE;
+            }
+        } else if (strcmp(argv[i], "--resume") == 0) {
+            resume = 1;
+        } else if (strcmp(argv[i], "--pin") == 0) {
+            pin = 1;
+        } else if (strcmp(argv[i], "--hugepages") == 0) {
+            hugepages = 1;
+        } else if (strcmp(argv[i], "--profile") == 0) {
+            profile_threads = 1;
+        } else if (strcmp(argv[i], "--trace") == 0 && i + 1 < argc) {
+            trace_path = argv[++i];
+        } else if (strcmp(argv[i], "--rule") == 0 && i + 1 < argc) {
+            const char *rule_spec = argv[++i];
+            if (parse_life_rule(rule_spec, &rule) != 0) {
+                fprintf(stderr, "Invalid rule (expected B/S notation, e.g. B36/S23): %s\n", rule_spec);
+                return EXIT_FAILURE;
+            }
+            rule_given = 1;
+        } else if (strcmp(argv[i], "--wrap") == 0) {
+            wrap_given = 1;
+        } else if (strcmp(argv[i], "--no-early-exit") == 0) {
+            early_exit = 0;
+        } else if (strcmp(argv[i], "--in-place") == 0) {
+            in_place = 1;
+        } else {
+            fprintf(stderr, "Unknown option: %s\n", argv[i]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    if (mkdir("output", 0755) != 0 && errno != EEXIST) {
+        fprintf(stderr, "Failed to create output directory: %s\n", strerror(errno));
+        return EXIT_FAILURE;
+    }
+
+    Placement placement;
+    if (placement_init(&placement, thread_count, pin, hugepages) != 0) {
+        return EXIT_FAILURE;
+    }
+
+    char checkpoint_path[160];
+    checkpoint_path_for(input_path, checkpoint_path, sizeof(checkpoint_path));
+
     int generations = 0;
+    int first_generation = 0;
     Grid world = {0};
+    struct stat checkpoint_stat;
 
-    if (load_world_from_file(input_path, &generations, &world) != 0) {
-        return EXIT_FAILURE;
+    if (resume && stat(checkpoint_path, &checkpoint_stat) == 0) {
+        /* The checkpoint's rule and borders apply unless --rule or --wrap asks for different ones */
+        LifeRule recorded = rule;
+        if (load_snapshot_with(checkpoint_path, &generations, &first_generation, &world, &recorded, allocate_first_touch, &placement) != 0) {
+            return EXIT_FAILURE;
+        }
+        if (wrap_given) {
+            rule.wrap = 1;
+        }
+        if (rule_given && memcmp(recorded.table, rule.table, sizeof(rule.table)) != 0) {
+            char recorded_spec[LIFE_RULE_SPEC_SIZE];
+            char rule_spec[LIFE_RULE_SPEC_SIZE];
+            format_life_rule(&recorded, recorded_spec, sizeof(recorded_spec));
+            format_life_rule(&rule, rule_spec, sizeof(rule_spec));
+            fprintf(stderr, "Checkpoint %s was written with %s, not %s; resume with the same --rule\n", checkpoint_path, recorded_spec, rule_spec);
+            free_grid(&world);
+            return EXIT_FAILURE;
+        }
+        if ((rule_given || wrap_given) && recorded.wrap != rule.wrap) {
+            fprintf(stderr, "Checkpoint %s was written with %s borders, not %s borders; resume with the same --wrap\n",
+                    checkpoint_path, recorded.wrap ? "toroidal" : "dead", rule.wrap ? "toroidal" : "dead");
+            free_grid(&world);
+            return EXIT_FAILURE;
+        }
+        rule = recorded;
+        printf("[Threads] Resuming from %s at generation %d of %d\n", checkpoint_path, first_generation, generations);
+    } else {
+        if (resume) {
+            printf("[Threads] No checkpoint at %s, starting from %s\n", checkpoint_path, input_path);
+        }
+        /* Without --rule, a rule named by the input file applies; --wrap only changes the borders */
+        if (load_world_from_file_with(input_path, &generations, &world, rule_given ? NULL : &rule, allocate_first_touch, &placement) != 0) {
+            return EXIT_FAILURE;
+        }
+        if (wrap_given) {
+            rule.wrap = 1;
+        }
     }
 
-    Grid buffer = allocate_grid(world.rows, world.cols);
-    if (!buffer.cells) {
+    /* In place, the second grid is replaced by a few cached rows per thread */
+    Grid buffer = {0};
+    if (!in_place) {
+        buffer = allocate_first_touch(world.rows, world.cols, &placement);
+    }
+    if (!in_place && !buffer.cells) {
         fprintf(stderr, "Failed to allocate buffer for next generation\n");
         free_grid(&world);
         return EXIT_FAILURE;
     }
 
+    Checkpointer checkpointer;
+    Checkpointer *ckpt = NULL;
+    if (checkpoint_every > 0) {
+        if (checkpointer_start(&checkpointer, checkpoint_path, &rule, checkpoint_every, generations, thread_count, world.rows, world.cols) != 0) {
+            free_grid(&world);
+            free_grid(&buffer);
+            return EXIT_FAILURE;
+        }
+        ckpt = &checkpointer;
+    }
+
+    Convergence convergence = {early_exit, calloc((size_t)thread_count, sizeof(int)), 0, 0};
+    ThreadProfile *profiles = calloc((size_t)thread_count, sizeof(ThreadProfile));
+    RowCache *caches = in_place ? calloc((size_t)thread_count, sizeof(RowCache)) : NULL;
+    /* Double buffered, the strips at the dead border share one read-only zero row */
+    unsigned char *dead_row = in_place ? NULL : calloc((size_t)world.cols, sizeof(unsigned char));
+    int profile_status = profiles && convergence.flags && (caches || dead_row) ? 0 : -1;
+    for (int i = 0; caches && i < thread_count; ++i) {
+        profile_status |= row_cache_init(&caches[i], world.cols);
+    }
+    for (int i = 0; trace_path && profiles && i < thread_count; ++i) {
+        profiles[i].marks = malloc(sizeof(uint64_t) * MARKS_PER_GENERATION * (size_t)(generations - first_generation + 1));
+        profile_status |= profiles[i].marks ? 0 : -1;
+    }
+
+    if (profile_status != 0) {
+        fprintf(stderr, "Failed to allocate thread profiles\n");
+        free(convergence.flags);
+        free(dead_row);
+        free_row_caches(caches, thread_count);
+        free_profiles(profiles, thread_count);
+        if (ckpt) {
+            checkpointer_stop(ckpt);
+        }
+        free_grid(&world);
+        free_grid(&buffer);
+        return EXIT_FAILURE;
+    }
+
     Grid *current = &world;
-    Grid *next = &buffer;
+    Grid *next = in_place ? &world : &buffer;
 
     struct timespec start_time = {0};
     struct timespec end_time = {0};
 
     clock_gettime(CLOCK_MONOTONIC, &start_time);
 
-    if (create_workers(thread_count, generations, &current, &next) != 0) {
-        free_grid(&world);
-        free_grid(&buffer);
-        return EXIT_FAILURE;
-    }
+    const int worker_status = create_workers(&placement, first_generation, generations, &current, &next, &rule, ckpt, &convergence, caches, dead_row, profiles);
 
     clock_gettime(CLOCK_MONOTONIC, &end_time);
 
-    if (mkdir("output", 0755) != 0 && errno != EEXIST) {
-        fprintf(stderr, "Failed to create output directory: %s\n", strerror(errno));
-        free_grid(current);
-        free_grid(next);
+    if (ckpt) {
+        checkpointer_stop(ckpt);
+    }
+    free(convergence.flags);
+    free(dead_row);
+    free_row_caches(caches, thread_count);
+
+    if (worker_status != 0) {
+        free_profiles(profiles, thread_count);
+        free_grid(&world);
+        free_grid(&buffer);
         return EXIT_FAILURE;
     }
 
     char output_path[160];
-    snprintf(output_path, sizeof(output_path), "output/game_of_life_threads_%dt_%dx%d_%dgen.txt", thread_count, current->rows, current->cols, generations);
+    snprintf(output_path, sizeof(output_path), "output/game_of_life_threads_%dt_%dx%d_%dgen.%s", thread_count, current->rows, current->cols, generations, world_format_extension(output_format));
 
-    FILE *out = fopen(output_path, "w");
+    FILE *out = fopen(output_path, "wb");
     if (!out) {
         fprintf(stderr, "Failed to open %s for writing: %s\n", output_path, strerror(errno));
-        free_grid(current);
-        free_grid(next);
+        free_profiles(profiles, thread_count);
+        free_grid(&world);
+        free_grid(&buffer);
         return EXIT_FAILURE;
     }
 
-    if (write_world(out, generations, current) != 0) {
+    if (write_world_as(out, output_format, generations, current, &rule) != 0) {
         fprintf(stderr, "Failed to write final world to %s\n", output_path);
         fclose(out);
-        free_grid(current);
-        free_grid(next);
+        free_profiles(profiles, thread_count);
+        free_grid(&world);
+        free_grid(&buffer);
         return EXIT_FAILURE;
     }
 
@@ -188,15 +841,55 @@ int main(int argc, char **argv) {
 
     const double elapsed = elapsed_seconds(&start_time, &end_time);
     const long peak_kb = get_peak_rss_kb();
+    const double cell_updates = (double)current->rows * (double)current->cols * (double)convergence.computed;
+    char rule_spec[LIFE_RULE_SPEC_SIZE];
+    format_life_rule(&rule, rule_spec, sizeof(rule_spec));
     printf("[Threads] Using %d threads\n", thread_count);
+    if (pin) {
+        printf("[Threads] Workers pinned to %d of %d CPUs\n", thread_count < placement.cpu_count ? thread_count : placement.cpu_count, placement.cpu_count);
+    }
+    if (hugepages) {
+        printf("[Threads] Huge pages: %s\n", current->mapping == GRID_MAPPED_HUGETLB ? "explicit (MAP_HUGETLB)" : "transparent (madvise)");
+    }
+    if (in_place) {
+        printf("[Threads] In-place stepping: one grid plus a %d-byte row cache per thread\n", 5 * current->cols);
+    }
+    printf("[Threads] Rule: %s (%s borders)\n", rule_spec, rule.wrap ? "toroidal" : "dead");
     printf("[Threads] Execution time: %.6f seconds\n", elapsed);
+    if (elapsed > 0.0) {
+        printf("[Threads] Throughput: %.3e cell updates/s\n", cell_updates / elapsed);
+    }
     if (peak_kb >= 0) {
         printf("[Threads] Peak memory: %ld KB\n", peak_kb);
     }
+    if (convergence.period > 0) {
+        printf("[Threads] Converged at generation %d (%s), skipped %d generations\n", first_generation + convergence.computed,
+               convergence.period == 1 ? "still life" : "period 2", generations - first_generation - convergence.computed);
+    }
+    report_profiles(profiles, thread_count, profile_threads);
+    if (trace_path) {
+        if (write_trace(trace_path, profiles, thread_count, first_generation, convergence.computed) == 0) {
+            printf("[Threads] Trace written to %s\n", trace_path);
+        } else {
+            fprintf(stderr, "Failed to write trace to %s\n", trace_path);
+        }
+    }
+    if (ckpt) {
+        printf("[Threads] Checkpoints: %d written every %d generations to %s%s\n",
+               ckpt->written, checkpoint_every, checkpoint_path, ckpt->failed ? " (some writes failed)" : "");
+        printf("[Threads] Checkpoint overhead: copy %.6f s, stall %.6f s, background write %.6f s\n",
+               ckpt->copy_seconds, ckpt->stall_seconds, ckpt->write_seconds);
+    }
     printf("[Threads] Output written to %s\n", output_path);
 
-    free_grid(current);
-    free_grid(next);
+    /* The run finished, so a later --resume must not pick up a stale snapshot */
+    if (ckpt || resume) {
+        remove(checkpoint_path);
+    }
+
+    free_profiles(profiles, thread_count);
+    free_grid(&world);
+    free_grid(&buffer);
 
     return EXIT_SUCCESS;
 }
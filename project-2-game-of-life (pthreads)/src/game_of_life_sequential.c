@@ -15,21 +15,61 @@ static double elapsed_seconds(const struct timespec *start, const struct timespe
 
 int main(int argc, char **argv) {
     if (argc < 2) {
-        fprintf(stderr, "Usage: %s <input_file>\n", argv[0]);
+        fprintf(stderr, "Usage: %s <input_file> [--format text|rle|bin] [--rule B3/S23] [--wrap] [--no-early-exit] [--in-place]\n", argv[0]);
         return EXIT_FAILURE;
     }
 
     const char *input_path = argv[1];
+    WorldFormat output_format = WORLD_FORMAT_TEXT;
+    LifeRule rule;
+    life_rule_default(&rule);
+    int rule_given = 0;
+    int wrap_given = 0;
+    int early_exit = 1;
+    int in_place = 0;
+
+    for (int i = 2; i < argc; ++i) {
+        if (strcmp(argv[i], "--format") == 0 && i + 1 < argc) {
+            if (parse_world_format(argv[++i], &output_format) != 0) {
+                fprintf(stderr, "Unknown output format: %s\n", argv[i]);
+                return EXIT_FAILURE;
+            }
+        } else if (strcmp(argv[i], "--rule") == 0 && i + 1 < argc) {
+            const char *rule_spec = argv[++i];
+            if (parse_life_rule(rule_spec, &rule) != 0) {
+                fprintf(stderr, "Invalid rule (expected B/S notation, e.g. B36/S23): %s\n", rule_spec);
+                return EXIT_FAILURE;
+            }
+            rule_given = 1;
+        } else if (strcmp(argv[i], "--wrap") == 0) {
+            wrap_given = 1;
+        } else if (strcmp(argv[i], "--no-early-exit") == 0) {
+            early_exit = 0;
+        } else if (strcmp(argv[i], "--in-place") == 0) {
+            in_place = 1;
+        } else {
+            fprintf(stderr, "Unknown option: %s\n", argv[i]);
+            return EXIT_FAILURE;
+        }
+    }
 
     int generations = 0;
     Grid current = {0};
 
-    if (load_world_from_file(input_path, &generations, &current) != 0) {
+    /* Without --rule, a rule named by the input file applies; --wrap only changes the borders */
+    if (load_world_from_file(input_path, &generations, &current, rule_given ? NULL : &rule) != 0) {
         return EXIT_FAILURE;
     }
+    if (wrap_given) {
+        rule.wrap = 1;
+    }
 
-    Grid next = allocate_grid(current.rows, current.cols);
-    if (!next.cells) {
+    /* In place, the second grid is replaced by a few cached rows */
+    Grid next = {0};
+    if (!in_place) {
+        next = allocate_grid(current.rows, current.cols);
+    }
+    if (!in_place && !next.cells) {
         fprintf(stderr, "Failed to allocate buffer for next generation\n");
         free_grid(&current);
         return EXIT_FAILURE;
@@ -40,16 +80,18 @@ int main(int argc, char **argv) {
 
     clock_gettime(CLOCK_MONOTONIC, &start_time);
 
-    for (int gen = 0; gen < generations; ++gen) {
-        step_range(&current, &next, 0, current.rows);
-
-        unsigned char *tmp = current.cells;
-        current.cells = next.cells;
-        next.cells = tmp;
-    }
+    int period = 0;
+    const int computed = in_place ? simulate_generations_in_place(&current, generations, &rule, early_exit, &period)
+                                  : simulate_generations(&current, &next, generations, &rule, early_exit, &period);
 
     clock_gettime(CLOCK_MONOTONIC, &end_time);
 
+    if (computed < 0) {
+        fprintf(stderr, "Failed to allocate the %s\n", in_place ? "row cache" : "dead border row");
+        free_grid(&current);
+        return EXIT_FAILURE;
+    }
+
     if (mkdir("output", 0755) != 0 && errno != EEXIST) {
         fprintf(stderr, "Failed to create output directory: %s\n", strerror(errno));
         free_grid(&current);
@@ -58,9 +100,9 @@ int main(int argc, char **argv) {
     }
 
     char output_path[160];
-    snprintf(output_path, sizeof(output_path), "output/game_of_life_seq_%dx%d_%dgen.txt", current.rows, current.cols, generations);
+    snprintf(output_path, sizeof(output_path), "output/game_of_life_seq_%dx%d_%dgen.%s", current.rows, current.cols, generations, world_format_extension(output_format));
 
-    FILE *out = fopen(output_path, "w");
+    FILE *out = fopen(output_path, "wb");
     if (!out) {
         fprintf(stderr, "Failed to open %s for writing: %s\n", output_path, strerror(errno));
         free_grid(&current);
@@ -68,7 +110,7 @@ int main(int argc, char **argv) {
         return EXIT_FAILURE;
     }
 
-    if (write_world(out, generations, &current) != 0) {
+    if (write_world_as(out, output_format, generations, &current, &rule) != 0) {
         fprintf(stderr, "Failed to write final world to %s\n", output_path);
         fclose(out);
         free_grid(&current);
@@ -80,7 +122,19 @@ int main(int argc, char **argv) {
 
     const double elapsed = elapsed_seconds(&start_time, &end_time);
     const long peak_kb = get_peak_rss_kb();
+    char rule_spec[LIFE_RULE_SPEC_SIZE];
+    format_life_rule(&rule, rule_spec, sizeof(rule_spec));
+    if (in_place) {
+        printf("[Sequential] In-place stepping: one grid plus a %d-byte row cache\n", 5 * current.cols);
+    }
+    printf("[Sequential] Rule: %s (%s borders)\n", rule_spec, rule.wrap ? "toroidal" : "dead");
     printf("[Sequential] Execution time: %.6f seconds\n", elapsed);
+    if (elapsed > 0.0) {
+        printf("[Sequential] Throughput: %.3e cell updates/s\n", (double)current.rows * (double)current.cols * (double)computed / elapsed);
+    }
+    if (period > 0) {
+        printf("[Sequential] Converged at generation %d (%s), skipped %d generations\n", computed, period == 1 ? "still life" : "period 2", generations - computed);
+    }
     if (peak_kb >= 0) {
         printf("[Sequential] Peak memory: %ld KB\n", peak_kb);
     }
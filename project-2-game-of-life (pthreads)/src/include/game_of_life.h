@@ -4,20 +4,142 @@
 #include <stdio.h>
 #include <stddef.h>
 
+typedef enum {
+    GRID_HEAP = 0,          /* calloc'd, zeroed by the allocator */
+    GRID_MAPPED,            /* anonymous mapping, pages placed on first touch */
+    GRID_MAPPED_HUGETLB     /* anonymous mapping backed by explicit huge pages */
+} GridMapping;
+
 typedef struct {
     int rows;
     int cols;
     unsigned char *cells;
+    GridMapping mapping;
+    size_t mapped_bytes;
 } Grid;
 
+/* Lets callers decide where the loaders put a new world (e.g. NUMA first touch). */
+typedef Grid (*GridAllocator)(int rows, int cols, void *context);
+
+/*
+ * Life-like rule in B/S notation compiled to a lookup table: the next state of
+ * a cell is table[alive * 9 + live_neighbours]. `wrap` selects toroidal
+ * boundaries instead of a dead border.
+ */
+typedef struct {
+    unsigned char table[18];
+    int wrap;
+} LifeRule;
+
+typedef enum {
+    WORLD_FORMAT_TEXT = 0,   /* coordinate list: generations, rows cols, alive count, r c lines */
+    WORLD_FORMAT_RLE,        /* standard Life RLE pattern (x = cols, y = rows) */
+    WORLD_FORMAT_BINARY      /* bit-packed snapshot with a "GOLB" header */
+} WorldFormat;
+
 Grid allocate_grid(int rows, int cols);
+Grid allocate_grid_untouched(int rows, int cols, int hugepages);
 void free_grid(Grid *grid);
 
-int load_world_from_file(const char *path, int *generations_out, Grid *grid_out);
+/* rule_out (may be NULL) receives the rule an RLE or binary header records and is left alone otherwise. */
+int load_world_from_file(const char *path, int *generations_out, Grid *grid_out, LifeRule *rule_out);
+int load_world_from_file_with(const char *path, int *generations_out, Grid *grid_out, LifeRule *rule_out, GridAllocator allocate, void *context);
+/*
+ * Binary layout: WORLD_BINARY_HEADER_SIZE header bytes, then one bit per cell
+ * (bit c & 7 of byte c >> 3), every row padded to packed_row_bytes(cols).
+ * The header may record the rule (NULL when encoding leaves it unrecorded);
+ * decoding overwrites *rule_out only when one is recorded.
+ */
+#define WORLD_BINARY_HEADER_SIZE 24
+
+size_t packed_row_bytes(int cols);
+void pack_cells(const unsigned char *cells, int count, unsigned char *packed);
+void unpack_cells(const unsigned char *packed, int count, unsigned char *cells);
+void encode_binary_header(unsigned char *header, int generations, int generation, int rows, int cols, const LifeRule *rule);
+int decode_binary_header(const unsigned char *header, const char *path, int *generations_out, int *generation_out, int *rows_out, int *cols_out, LifeRule *rule_out);
+
+/* Binary snapshots additionally record how many generations were already computed. */
+int load_snapshot(const char *path, int *generations_out, int *generation_out, Grid *grid_out, LifeRule *rule_out);
+int load_snapshot_with(const char *path, int *generations_out, int *generation_out, Grid *grid_out, LifeRule *rule_out, GridAllocator allocate, void *context);
+int write_snapshot(FILE *out, int generations, int generation, const Grid *grid, const LifeRule *rule);
+
 int write_world(FILE *out, int generations, const Grid *grid);
+/* RLE and binary output record `rule` (NULL for Conway's) in their header. */
+int write_world_as(FILE *out, WorldFormat format, int generations, const Grid *grid, const LifeRule *rule);
+int parse_world_format(const char *name, WorldFormat *format_out);
+const char *world_format_extension(WorldFormat format);
 int count_alive_cells(const Grid *grid);
 
+#define LIFE_RULE_SPEC_SIZE 24 /* "B012345678/S012345678" and the terminator */
+
+void life_rule_default(LifeRule *rule);
+int parse_life_rule(const char *spec, LifeRule *rule_out);
+void format_life_rule(const LifeRule *rule, char *spec, size_t size);
+
+/*
+ * step_range_rule/step_block return a combination of these flags for the
+ * cells they computed, which lets callers detect still lifes (no change) and
+ * period-2 oscillators (no change from the generation before `current`).
+ * `dead_row` is the caller's row of `cols` zero bytes standing in for the
+ * dead border; it may be NULL when the rule wraps or the rows stay clear of
+ * the first and last row of the grid.
+ */
+#define STEP_CHANGED 1               /* a new cell differs from `current` */
+#define STEP_CHANGED_FROM_PREVIOUS 2 /* a new cell differs from what `next` held */
+
 void step_range(const Grid *current, Grid *next, int start_row, int end_row);
+int step_range_rule(const Grid *current, Grid *next, int start_row, int end_row, const LifeRule *rule, const unsigned char *dead_row);
+int step_block(const Grid *current, Grid *next, int start_row, int end_row, int start_col, int end_col, const LifeRule *rule, const unsigned char *dead_row);
+
+/*
+ * In-place stepping on a single grid. A RowCache keeps the old contents of the
+ * two rows just outside a strip (saved with row_cache_save_halo before any
+ * strip of the generation is overwritten) and a rolling window of the last two
+ * rows the strip has overwritten, so the next generation needs only 5 * cols
+ * bytes per strip instead of a second grid. Only STEP_CHANGED is meaningful
+ * in the result, since there is no older generation to compare against.
+ */
+typedef struct {
+    int cols;
+    unsigned char *rows;
+    const unsigned char *above;
+    const unsigned char *below;
+} RowCache;
+
+int row_cache_init(RowCache *cache, int cols);
+void row_cache_free(RowCache *cache);
+void row_cache_save_halo(RowCache *cache, const Grid *grid, int start_row, int end_row, const LifeRule *rule);
+int step_range_in_place(Grid *grid, int start_row, int end_row, RowCache *cache, const LifeRule *rule);
+
+/*
+ * Steps `current` up to `generations` times on one thread, swapping the cell
+ * buffers of `current` and `next` so that `current` ends on the final state.
+ * With early_exit the run stops at a still life (*period_out = 1) or a
+ * period-2 oscillator (*period_out = 2). Returns the generations stepped,
+ * or -1 if out of memory.
+ */
+int simulate_generations(Grid *current, Grid *next, int generations, const LifeRule *rule, int early_exit, int *period_out);
+/* Same on a single grid with step_range_in_place (still lifes only); -1 if out of memory. */
+int simulate_generations_in_place(Grid *grid, int generations, const LifeRule *rule, int early_exit, int *period_out);
+
+/*
+ * In-memory batch API for parameter sweeps: every world is stepped to its own
+ * generation count and `grid` is overwritten with the final state, without
+ * any file I/O. Worlds are handed out to a pool of `thread_count` threads;
+ * tiny worlds that share size and rule are packed 64 at a time into the bit
+ * lanes of 64-bit words and stepped together by one task.
+ */
+#define BATCH_LANES 64
+#define BATCH_LANE_MAX_CELLS 4096 /* worlds up to this many cells are lane-packed */
+
+typedef struct {
+    Grid grid;            /* initial state in, final state out */
+    LifeRule rule;
+    int generations;
+    int computed;         /* out: generations actually stepped (less after early exit) */
+} BatchWorld;
+
+int simulate_batch(BatchWorld *worlds, int count, int thread_count, int early_exit);
 
 long get_peak_rss_kb(void);
 
@@ -0,0 +1,154 @@
+#!/usr/bin/env python3
+"""
+Game of Life benchmark suite.
+
+Generates random worlds of several sizes and densities with
+generate_samples.py, runs the sequential and pthreads binaries on each of
+them (several thread counts, several repetitions), and reports cell
+updates/second, speedup, parallel efficiency and run-to-run variance.
+
+Results are written to <out>/runs.csv (one line per run),
+<out>/summary.csv and <out>/summary.json (one entry per configuration).
+Run it from the project root, usually through `make bench`.
+"""
+import argparse
+import csv
+import json
+import os
+import re
+import statistics
+import subprocess
+import sys
+from pathlib import Path
+
+SEQ_BIN = "bin/game_of_life_seq"
+PAR_BIN = "bin/game_of_life_pthread"
+
+TIME_RE = re.compile(r"Execution time: ([0-9.]+) seconds")
+MEMORY_RE = re.compile(r"Peak memory: ([0-9]+) KB")
+
+
+def int_list(text):
+    return [int(item) for item in text.split(",") if item.strip()]
+
+
+def float_list(text):
+    return [float(item) for item in text.split(",") if item.strip()]
+
+
+def generate_world(samples_dir, size, density, generations, seed):
+    name = f"bench_{size}x{size}_{round(density * 100)}pct_{generations}gen"
+    path = samples_dir / f"{name}.bin"
+    if not path.exists():
+        subprocess.run(
+            [sys.executable, "tools/generate_samples.py",
+             "--formats", "bin", "--output-dir", str(samples_dir), "--seed", str(seed),
+             "--name", name, "--random", str(size), str(size), str(density), str(generations)],
+            check=True, stdout=subprocess.DEVNULL,
+        )
+    return path
+
+
+def run_binary(command):
+    result = subprocess.run(command, check=True, capture_output=True, text=True)
+    time_match = TIME_RE.search(result.stdout)
+    memory_match = MEMORY_RE.search(result.stdout)
+    if not time_match:
+        raise RuntimeError(f"no execution time in output of {' '.join(command)}:\n{result.stdout}")
+    return float(time_match.group(1)), int(memory_match.group(1)) if memory_match else None
+
+
+def summarize(times):
+    mean = statistics.mean(times)
+    variance = statistics.variance(times) if len(times) > 1 else 0.0
+    return mean, variance, min(times)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--sizes", type=int_list, default=[512, 1024, 2048], help="square world sizes (default: 512,1024,2048)")
+    parser.add_argument("--densities", type=float_list, default=[0.1, 0.3, 0.5], help="initial alive fractions (default: 0.1,0.3,0.5)")
+    parser.add_argument("--threads", type=int_list, default=[1, 2, 4, 8], help="pthreads thread counts (default: 1,2,4,8)")
+    parser.add_argument("--generations", type=int, default=100, help="generations per run (default: 100)")
+    parser.add_argument("--reps", type=int, default=3, help="repetitions per configuration (default: 3)")
+    parser.add_argument("--seed", type=int, default=42, help="seed for world generation (default: 42)")
+    parser.add_argument("--samples-dir", default="samples/bench", help="where generated worlds are cached")
+    parser.add_argument("--out", default="bench", help="directory for CSV/JSON results (default: bench)")
+    parser.add_argument("--extra-args", default="", help="extra options passed to the pthreads binary (e.g. '--pin')")
+    args = parser.parse_args()
+
+    for binary in (SEQ_BIN, PAR_BIN):
+        if not os.access(binary, os.X_OK):
+            parser.error(f"{binary} not found, build it first (make sequential parallel)")
+
+    samples_dir = Path(args.samples_dir)
+    out_dir = Path(args.out)
+    samples_dir.mkdir(parents=True, exist_ok=True)
+    out_dir.mkdir(parents=True, exist_ok=True)
+
+    runs = []
+    summary = []
+
+    for size in args.sizes:
+        for density in args.densities:
+            world = generate_world(samples_dir, size, density, args.generations, args.seed)
+            cell_updates = float(size) * size * args.generations
+
+            # Every run must step all generations for the cell update counts to hold
+            configs = [("sequential", 1, [SEQ_BIN, str(world), "--format", "bin", "--no-early-exit"])]
+            for threads in args.threads:
+                configs.append(("pthreads", threads,
+                                [PAR_BIN, str(world), str(threads), "--format", "bin", "--no-early-exit"]
+                                + args.extra_args.split()))
+
+            baseline = None
+            for engine, threads, command in configs:
+                times = []
+                peak_kb = None
+                for rep in range(args.reps):
+                    elapsed, memory = run_binary(command)
+                    times.append(elapsed)
+                    peak_kb = memory if peak_kb is None or (memory or 0) > peak_kb else peak_kb
+                    runs.append({
+                        "engine": engine, "threads": threads, "size": size, "density": density,
+                        "generations": args.generations, "rep": rep, "seconds": elapsed,
+                        "cell_updates_per_s": cell_updates / elapsed if elapsed > 0 else 0.0,
+                        "peak_kb": memory,
+                    })
+
+                mean, variance, best = summarize(times)
+                if engine == "sequential":
+                    baseline = mean
+                speedup = baseline / mean if mean > 0 else 0.0
+                entry = {
+                    "engine": engine, "threads": threads, "size": size, "density": density,
+                    "generations": args.generations, "reps": args.reps,
+                    "mean_s": mean, "variance_s2": variance, "stdev_s": variance ** 0.5, "min_s": best,
+                    "cell_updates_per_s": cell_updates / mean if mean > 0 else 0.0,
+                    "speedup": speedup, "efficiency": speedup / threads,
+                    "peak_kb": peak_kb,
+                }
+                summary.append(entry)
+                print(f"[Bench] {engine:<10} {threads:>2}t {size}x{size} {density:.0%}: "
+                      f"{mean:.4f} s (stdev {entry['stdev_s']:.4f}), "
+                      f"{entry['cell_updates_per_s']:.3e} cells/s, "
+                      f"speedup {speedup:.2f}, efficiency {entry['efficiency']:.2f}")
+
+    with open(out_dir / "runs.csv", "w", newline="") as f:
+        writer = csv.DictWriter(f, fieldnames=list(runs[0].keys()))
+        writer.writeheader()
+        writer.writerows(runs)
+
+    with open(out_dir / "summary.csv", "w", newline="") as f:
+        writer = csv.DictWriter(f, fieldnames=list(summary[0].keys()))
+        writer.writeheader()
+        writer.writerows(summary)
+
+    with open(out_dir / "summary.json", "w") as f:
+        json.dump({"configurations": summary}, f, indent=2)
+
+    print(f"[Bench] Results written to {out_dir}/runs.csv, summary.csv and summary.json")
+
+
+if __name__ == "__main__":
+    main()
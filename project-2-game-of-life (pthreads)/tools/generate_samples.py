@@ -1,25 +1,97 @@
 #!/usr/bin/env python3
+import argparse
 import os
 import random
+import struct
 from pathlib import Path
 
 SAMPLES_DIR = Path("samples")
 SAMPLES_DIR.mkdir(exist_ok=True)
 
+# Formats emitted for every sample: "txt" (coordinate list), "rle", "bin"
+FORMATS = ["txt"]
+
 # ------------------------------------------------------------
 # Helper functions
 # ------------------------------------------------------------
 
-def write_sample(filename, rows, cols, generations, alive_cells):
-    """Write a sample file in the required format."""
-    path = SAMPLES_DIR / filename
+def write_text(path, rows, cols, generations, alive_cells):
+    """Coordinate-list format: generations, rows cols, alive count, r c lines."""
     with open(path, "w") as f:
         f.write(f"{generations}\n")
         f.write(f"{rows} {cols}\n")
         f.write(f"{len(alive_cells)}\n")
         for r, c in alive_cells:
             f.write(f"{r} {c}\n")
-    print(f"[OK] Generated {path}")
+
+
+def write_rle(path, rows, cols, generations, alive_cells):
+    """Standard Life RLE; the generation count travels in a #C comment."""
+    by_row = {}
+    for r, c in alive_cells:
+        by_row.setdefault(r, set()).add(c)
+
+    tokens = []
+
+    def emit(count, tag):
+        tokens.append(f"{count}{tag}" if count > 1 else tag)
+
+    pending_rows = 0
+    for r in range(rows):
+        alive = by_row.get(r)
+        if not alive:
+            pending_rows += 1
+            continue
+        if pending_rows:
+            emit(pending_rows, "$")
+        pending_rows = 1
+
+        c = 0
+        last = max(alive)
+        while c <= last:
+            state = c in alive
+            run = 1
+            while c + run <= last and ((c + run) in alive) == state:
+                run += 1
+            emit(run, "o" if state else "b")
+            c += run
+
+    with open(path, "w") as f:
+        f.write(f"#C generations {generations}\n")
+        f.write(f"x = {cols}, y = {rows}, rule = B3/S23\n")
+        width = 0
+        for token in tokens:
+            if width + len(token) > 70:
+                f.write("\n")
+                width = 0
+            f.write(token)
+            width += len(token)
+        f.write("!\n")
+
+
+def write_binary(path, rows, cols, generations, alive_cells):
+    """Bit-packed snapshot: 'GOLB', version, generations, generation, rows, cols."""
+    row_bytes = (cols + 7) // 8
+    data = bytearray(rows * row_bytes)
+    for r, c in alive_cells:
+        data[r * row_bytes + (c >> 3)] |= 1 << (c & 7)
+
+    with open(path, "wb") as f:
+        f.write(b"GOLB")
+        f.write(struct.pack("<IiiII", 1, generations, 0, rows, cols))
+        f.write(data)
+
+
+WRITERS = {"txt": write_text, "rle": write_rle, "bin": write_binary}
+
+
+def write_sample(filename, rows, cols, generations, alive_cells):
+    """Write a sample file in every requested format."""
+    stem = Path(filename).stem
+    for fmt in FORMATS:
+        path = SAMPLES_DIR / f"{stem}.{fmt}"
+        WRITERS[fmt](path, rows, cols, generations, alive_cells)
+        print(f"[OK] Generated {path}")
 
 
 def center_pattern(rows, cols, pattern):
@@ -102,7 +174,37 @@ def glider_gun():
 # ------------------------------------------------------------
 
 def main():
-    random.seed(42)  # reproducible samples
+    parser = argparse.ArgumentParser(description="Generate Game of Life sample worlds.")
+    parser.add_argument(
+        "--formats", default="txt",
+        help="comma-separated list of formats to emit: txt, rle, bin (default: txt)"
+    )
+    parser.add_argument(
+        "--random", nargs=4, metavar=("ROWS", "COLS", "DENSITY", "GENERATIONS"),
+        help="only generate one random world (used by the benchmark suite)"
+    )
+    parser.add_argument("--name", help="file name (without extension) for --random")
+    parser.add_argument("--output-dir", default="samples", help="directory for generated files")
+    parser.add_argument("--seed", type=int, default=42, help="random seed (default: 42)")
+    args = parser.parse_args()
+
+    FORMATS[:] = [fmt.strip() for fmt in args.formats.split(",") if fmt.strip()]
+    unknown = [fmt for fmt in FORMATS if fmt not in WRITERS]
+    if unknown:
+        parser.error(f"unknown format(s): {', '.join(unknown)}")
+
+    global SAMPLES_DIR
+    SAMPLES_DIR = Path(args.output_dir)
+    SAMPLES_DIR.mkdir(parents=True, exist_ok=True)
+
+    random.seed(args.seed)  # reproducible samples
+
+    if args.random:
+        rows, cols = int(args.random[0]), int(args.random[1])
+        density, generations = float(args.random[2]), int(args.random[3])
+        name = args.name or f"random_{rows}x{cols}_{round(density * 100)}pct_{generations}gen"
+        write_sample(f"{name}.txt", rows, cols, generations, random_pattern(rows, cols, density))
+        return
 
     # ---------------- Small patterns ----------------
     write_sample(
@@ -0,0 +1,56 @@
+#pragma once
+
+#include "nbody/Body.hpp"
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+namespace nbody {
+
+// Barnes-Hut quadtree over a BodyPositions snapshot of 2D bodies.
+// Nodes live in a flat pool (indices instead of pointers) and are built top-down
+// in parallel with OpenMP tasks. Leaves hold up to LEAF_SIZE bodies, stored
+// contiguously in tree order so they can be summed with ForceKernel.
+class BarnesHutTree {
+public:
+    static constexpr int LEAF_SIZE = 16;
+    static constexpr int MAX_DEPTH = 64;
+
+    BarnesHutTree(double theta, double softening);
+
+    // Rebuilds the tree; call from outside any OpenMP parallel region
+    void build(const BodyPositions& bodies);
+
+    // Same contract as ForceKernel::accumulate (including the optional
+    // potential sum), approximating far cells by their centre of mass.
+    // Returns the number of interactions evaluated.
+    std::uint64_t accumulate(double xi, double yi, double& ax, double& ay, double* phi = nullptr) const;
+
+    double theta() const { return theta_; }
+    std::size_t nodeCount() const { return static_cast<std::size_t>(node_count_.load()); }
+
+private:
+    struct Node {
+        double com_x, com_y, mass;   // centre of mass of the subtree
+        double cx, cy, half;         // cell centre and half width
+        double open_sq;              // squared distance below which the cell is opened
+        int children[4];             // pool indices, -1 when empty
+        int begin, end;              // body range in tree order
+        bool leaf;
+    };
+
+    double theta_;
+    double softening_sq_;
+    std::vector<Node> pool_;
+    std::atomic<int> node_count_{0};
+    std::vector<int> order_;
+
+    // Bodies in tree order (SoA)
+    BodyPositions sorted_;
+
+    void buildNode(int index, const BodyPositions& bodies, int depth);
+    void makeLeaf(Node& node, const BodyPositions& bodies);
+    void setOpeningRadius(Node& node) const;
+};
+
+} // namespace nbody
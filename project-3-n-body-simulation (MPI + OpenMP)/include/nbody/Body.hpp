@@ -1,14 +1,16 @@
 #pragma once
 
+#include <cstddef>
 #include <vector>
 #include <mpi.h>
 
 namespace nbody {
 
-// POD structure aligned to 32 bytes
+// POD structure aligned to 32 bytes. 2D systems keep z and vz at zero; the
+// struct is 64 bytes either way.
 struct alignas(32) Body {
-    double x, y;
-    double vx, vy;
+    double x, y, z;
+    double vx, vy, vz;
     double mass;
     
     // Static helper to create the MPI custom type
@@ -17,4 +19,24 @@ struct alignas(32) Body {
 
 using SystemState = std::vector<Body>;
 
-} // namespace nbody
\ No newline at end of file
+// Structure-of-arrays copy of the fields the force kernel reads,
+// so the inner loop streams contiguous arrays. z stays empty for 2D
+// systems, and zData() is then null, which is how ForceKernel tells them apart.
+struct BodyPositions {
+    std::vector<double> x;
+    std::vector<double> y;
+    std::vector<double> z;
+    std::vector<double> mass;
+
+    void resize(std::size_t n, int dimensions = 2) {
+        x.resize(n);
+        y.resize(n);
+        z.resize(dimensions == 3 ? n : 0);
+        mass.resize(n);
+    }
+
+    std::size_t size() const { return x.size(); }
+    const double* zData() const { return z.empty() ? nullptr : z.data(); }
+};
+
+} // namespace nbody
@@ -2,10 +2,10 @@
 
 namespace nbody {
 
-// Gravitational Constant
+// Default Gravitational Constant (--gravity overrides it per run)
 constexpr double G = 1.0; 
 
-// Default Softening parameter (to prevent division by zero)
+// Default Softening parameter (to prevent division by zero; --softening overrides it per run)
 constexpr double SOFTENING = 1e-9;
 
 } // namespace nbody
\ No newline at end of file
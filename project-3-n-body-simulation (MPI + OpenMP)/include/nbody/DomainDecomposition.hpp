@@ -5,6 +5,9 @@
 
 namespace nbody {
 
+// Every rank owns a contiguous range of the global body order. By default the
+// ranges are equal by count; setCounts() installs a weighted partition (e.g.
+// from measured cost) that applies while the total number of bodies matches.
 class DomainDecomposition {
 public:
     DomainDecomposition(int rank, int size);
@@ -19,12 +22,18 @@ public:
     // Returns {counts, displacements}
     std::pair<std::vector<int>, std::vector<int>> getcv(int total_bodies) const;
 
+    // Bodies per rank, one entry per rank; an empty vector restores the even split
+    void setCounts(const std::vector<int>& counts);
+    bool isWeighted() const { return !counts_.empty(); }
+
     int getRank() const { return rank_; }
     int getSize() const { return size_; }
 
 private:
     int rank_;
     int size_;
+    std::vector<int> counts_;
+    long long counts_total_ = 0;
 };
 
-} // namespace nbody
\ No newline at end of file
+} // namespace nbody
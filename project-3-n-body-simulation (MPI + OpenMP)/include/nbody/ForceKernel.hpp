@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstddef>
+
+namespace nbody {
+
+class ForceKernel {
+public:
+    // Name of the variant selected at build time (e.g. "avx512", "avx2+rsqrt")
+    static const char* name();
+
+    // Accumulates sum_j m_j * (r_j - r_i) / (|r_j - r_i|^2 + softening_sq)^(3/2)
+    // over n bodies stored as structure-of-arrays into (ax, ay). The result
+    // still has to be scaled by G * m_i. The target itself (and any body at
+    // its position) has a squared distance of softening_sq alone and is
+    // dropped by a lane mask, so a tiny softening cannot overflow the sum.
+    // With phi given, the same pass also adds the potential sum
+    // sum_{j != i} m_j / (|r_j - r_i|^2 + softening_sq)^(1/2) to *phi (to be
+    // scaled by -G * m_i); without it the potential term is not compiled in.
+    static void accumulate(const double* x, const double* y, const double* mass, std::size_t n,
+                           double xi, double yi, double softening_sq, double& ax, double& ay,
+                           double* phi = nullptr);
+
+    // Register-blocked variant for m targets (xi, yi)[0..m): every body loaded
+    // from the arrays is used for TARGET_BLOCK targets at once. Adds the same
+    // unscaled sums as accumulate to (ax, ay)[0..m). With z, zi and az given the
+    // bodies are 3D; with null ones 2D. Either way the call dispatches once to
+    // the kernel compiled for that dimension, so the loops carry no z branch.
+    // phi[0..m), when given, receives the potential sums as in accumulate.
+    static constexpr std::size_t TARGET_BLOCK = 4;
+    static void accumulateMany(const double* x, const double* y, const double* z, const double* mass, std::size_t n,
+                               const double* xi, const double* yi, const double* zi, std::size_t m,
+                               double softening_sq, double* ax, double* ay, double* az, double* phi = nullptr);
+
+    // Mixed precision: the pair terms and the sum over the n bodies are
+    // computed in float (twice the SIMD lanes), then added to the double
+    // (ax, ay, az). Positions should be relative to a common origin near the
+    // bodies, so that float keeps the precision of their differences.
+    static void accumulateMany(const float* x, const float* y, const float* z, const float* mass, std::size_t n,
+                               const float* xi, const float* yi, const float* zi, std::size_t m,
+                               double softening_sq, double* ax, double* ay, double* az, double* phi = nullptr);
+
+    // Symmetric variant over the pairs of two index blocks [i_begin, i_end) x
+    // [j_begin, j_end) of the same arrays: each pair is evaluated once, adding
+    // its contribution to (ax, ay, az)[i] and the opposite one to (ax, ay, az)[j].
+    // When the blocks coincide only pairs with j > i are visited. z and az are
+    // null for 2D bodies, as for accumulateMany. phi, when given, receives each
+    // pair's potential terms at both i and j.
+    static void accumulatePairs(const double* x, const double* y, const double* z, const double* mass,
+                                std::size_t i_begin, std::size_t i_end, std::size_t j_begin, std::size_t j_end,
+                                double softening_sq, double* ax, double* ay, double* az, double* phi = nullptr);
+};
+
+} // namespace nbody
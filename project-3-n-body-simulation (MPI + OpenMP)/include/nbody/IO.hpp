@@ -1,19 +1,72 @@
 #pragma once
 
 #include "nbody/Body.hpp"
+#include "nbody/DomainDecomposition.hpp"
+#include <cstdint>
 #include <string>
+#include <vector>
 
 namespace nbody {
 
+// Binary state file: a fixed BINARY_HEADER_SIZE-byte little-endian header
+// followed by one record of `fields` doubles per body, mass x y vx vy first
+// (mass x y z vx vy vz in 3D, the text column order). Records are fixed size,
+// so every rank can read or write its own slice at header + start * fields * 8
+// with MPI-IO.
+struct BinaryHeader {
+    char magic[8];          // "NBODYBIN"
+    std::uint32_t version;
+    std::uint32_t fields;   // doubles per body record (at least 5)
+    std::uint64_t count;    // number of bodies
+    std::int32_t steps;     // same meaning as in the text header
+    std::int32_t dimensions; // 2 or 3 (files from before 3D support hold 0, read as 2)
+    double dt;
+    std::uint64_t step;     // steps already simulated
+    char reserved[16];
+};
+
 class IO {
 public:
     // Reads input file: N, N_STEPS, dt, followed by bodies
     // Returns a pair: {dt, steps}
-    // The bodies vector is populated by reference
-    static std::pair<double, int> readInput(const std::string& filename, SystemState& bodies);
+    // The bodies vector is populated by reference. Bodies have five columns
+    // (mass x y vx vy) or seven (mass x y z vx vy vz); the first body line
+    // sets `dimensions` to 2 or 3 for the whole file.
+    static std::pair<double, int> readInput(const std::string& filename, SystemState& bodies, int& dimensions);
 
     // Writes the final state to a file
-    static void writeOutput(const std::string& filename, const SystemState& bodies, double dt, int steps);
+    static void writeOutput(const std::string& filename, const SystemState& bodies, double dt, int steps,
+                            int dimensions = 2);
+
+    static constexpr std::uint32_t BINARY_VERSION = 1;
+    static constexpr std::size_t BINARY_HEADER_SIZE = 64;
+
+    // Doubles of body state per record: mass, position and velocity
+    static constexpr std::uint32_t stateFields(int dimensions) { return 1 + 2 * static_cast<std::uint32_t>(dimensions); }
+
+    // Header and records of a binary state file, shared with SnapshotWriter.
+    // `extra` optionally holds extra_fields more doubles per body, appended
+    // to each record after the state fields (e.g. checkpointed integrator state).
+    static BinaryHeader makeBinaryHeader(std::size_t total_bodies, int dimensions, double dt, int steps,
+                                         std::uint64_t step, std::uint32_t extra_fields = 0);
+    static void packRecords(const SystemState& bodies, int dimensions, std::vector<double>& records,
+                            const std::vector<double>* extra = nullptr, std::uint32_t extra_fields = 0);
+
+    // True when the file starts with the binary magic (checked on the calling rank only)
+    static bool isBinary(const std::string& filename);
+
+    // Collective: every rank opens the file with MPI-IO and reads the records of
+    // the bodies `domain` assigns to it. Fields beyond the state fields go to
+    // `extra` when given. Returns the header, with dimensions set to 2 or 3.
+    static BinaryHeader readBinary(const std::string& filename, const DomainDecomposition& domain,
+                                   SystemState& local_bodies, std::vector<double>* extra = nullptr);
+
+    // Collective: rank 0 writes the header, every rank its own slice of
+    // `total_bodies` at the offset `domain` assigns to it
+    static void writeBinary(const std::string& filename, const DomainDecomposition& domain,
+                            const SystemState& local_bodies, std::size_t total_bodies, int dimensions,
+                            double dt, int steps, std::uint64_t step = 0,
+                            const std::vector<double>* extra = nullptr, std::uint32_t extra_fields = 0);
 };
 
 } // namespace nbody
\ No newline at end of file
@@ -1,40 +1,242 @@
 #pragma once
 
 #include "nbody/Body.hpp"
+#include "nbody/BarnesHut.hpp"
+#include "nbody/Constants.hpp"
 #include "nbody/DomainDecomposition.hpp"
+#include "nbody/SnapshotWriter.hpp"
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <string>
 #include <vector>
 
 namespace nbody {
 
+enum class Solver { Direct, Symmetric, BarnesHut };
+
+// Euler: semi-implicit (symplectic) Euler, 1st order, one force pass per step
+// Leapfrog: velocity-Verlet kick-drift-kick, 2nd order, one force pass per step
+// Yoshida4: three leapfrog substeps with Yoshida's weights, 4th order, three passes
+enum class Integrator { Euler, Leapfrog, Yoshida4 };
+
+// Direct solver arithmetic: all double, or float pair terms summed per slice
+// and accumulated in double (ForceKernel's mixed precision accumulateMany)
+enum class Precision { Double, Mixed };
+
+// Order of the bodies during the run: as read, or sorted along a space-filling
+// curve (files are always written in input order)
+enum class Ordering { Input, Morton, Hilbert };
+
+struct SimulationOptions {
+    Solver solver = Solver::Direct;
+    Integrator integrator = Integrator::Euler;
+    double theta = 0.5;             // Barnes-Hut opening angle
+    double gravity = G;             // gravitational constant in the input's units
+    double softening = SOFTENING;   // Plummer softening length (must be positive)
+    Precision precision = Precision::Double;
+    int block_levels = 0;           // block timesteps down to dt / 2^block_levels (0 = off)
+    double eta = 0.1;               // block timestep accuracy parameter
+    int snapshot_every = 0;         // write a snapshot every K steps (0 = off)
+    std::string snapshot_prefix = "snapshot";
+    int checkpoint_every = 0;       // write a checkpoint every K steps (0 = off)
+    std::string checkpoint_path = "checkpoint.nbody";
+    int rebalance_every = 0;        // repartition by measured cost every K steps (0 = off)
+    int diagnostics_every = 0;      // energy and momenta every K steps (0 = off)
+    std::string diagnostics_path = "diagnostics.txt";
+    Ordering ordering = Ordering::Input;
+    int reorder_every = 10;         // re-sort along the curve every K steps
+    bool compare_direct = false;    // report the force error against the double direct solver
+};
+
+// Conserved quantities of the whole system at one step
+struct Diagnostics {
+    double kinetic = 0.0;
+    double potential = 0.0;
+    double momentum[3] = {};
+    double angular_momentum[3] = {};   // about the origin; only z is non-zero in 2D
+
+    double total() const { return kinetic + potential; }
+};
+
 class Simulation {
 public:
-    Simulation(const DomainDecomposition& domain);
+    Simulation(const DomainDecomposition& domain, const SimulationOptions& options = SimulationOptions{});
 
     // Distributed Initialization:
     // Takes the full set of bodies (only valid on Rank 0) 
     // and scatters them to local storage.
-    void init(const SystemState& global_initial_bodies);
+    // `dimensions` (2 or 3) is taken from Rank 0 as well.
+    void init(const SystemState& global_initial_bodies, int dimensions = 2);
+
+    // Same, for bodies that were already read per rank (e.g. IO::readBinary);
+    // `local_bodies` must be this rank's slice of `total_bodies`
+    void initLocal(const SystemState& local_bodies, int total_bodies, int dimensions = 2);
+
+    // Checkpoints store the integrator state in checkpointFields() extra
+    // doubles per body (block timestep level and last acceleration). Forces
+    // are not stored, they are recomputed from the positions on restart.
+    static constexpr std::uint32_t checkpointFields(int dimensions) { return 1 + static_cast<std::uint32_t>(dimensions); }
+
+    // Continues a checkpointed run after initLocal: run() resumes at `step`.
+    // `extra` holds checkpointFields() doubles per local body, or is empty for
+    // a plain state file.
+    void restore(const std::vector<double>& extra, std::uint64_t step);
 
     void run(int steps, double dt);
     
     // Gathers all data to Rank 0 for output
     SystemState gatherFinalState() const;
 
+    // This rank's slice, for collective writers such as IO::writeBinary
+    const SystemState& localBodies() const { return local_bodies_; }
+    const DomainDecomposition& domain() const { return domain_; }
+    int totalBodies() const { return static_cast<int>(global_bodies_snapshot_.size()); }
+    int dimensions() const { return dimensions_; }
+
 private:
     DomainDecomposition domain_;
+    SimulationOptions options_;
+    double softening_sq_;
+
+    // 2 or 3. Bodies always carry z, which stays zero in 2D; the force passes
+    // skip it by handing ForceKernel null z arrays.
+    int dimensions_ = 2;
     
     // The slice of bodies this rank owns and updates
     SystemState local_bodies_;
     
-    // A buffer to hold the positions of ALL bodies (refreshed every step)
-    SystemState global_bodies_snapshot_;
+    // Positions and masses of ALL bodies in SoA layout, refreshed every step
+    // for the solvers that need every body at once (symmetric, Barnes-Hut)
+    BodyPositions global_bodies_snapshot_;
+
+    // This rank's positions packed for the gather
+    BodyPositions local_positions_;
+
+    // Solver::Direct: the block being computed and the one arriving from the
+    // left neighbour, each laid out as [x | y | mass] ([x | y | z | mass] in 3D)
+    // with a stride of the largest rank's body count
+    std::vector<double> ring_current_;
+    std::vector<double> ring_next_;
+    int ring_stride_ = 0;
+
+    // Precision::Mixed: the block held, as float positions relative to a
+    // common origin (the centre of the bodies' bounding box)
+    std::vector<float> ring_float_;
+    double origin_x_ = 0.0;
+    double origin_y_ = 0.0;
+    double origin_z_ = 0.0;
+
+    // Direct solver loop nest: targets in tiles of i_tile_, each swept over
+    // the block in slices of j_tile_ bodies (chosen by tuneTiles)
+    int i_tile_ = 128;
+    int j_tile_ = 2048;
     
     // Temporary forces
     std::vector<double> forces_x_;
     std::vector<double> forces_y_;
-    
-    void computeForces();
-    void updatePositions(double dt);
+    std::vector<double> forces_z_;
+
+    // Background writer for --snapshot-every
+    std::unique_ptr<SnapshotWriter> snapshots_;
+
+    // Barnes-Hut tree over the snapshot (only with Solver::BarnesHut)
+    std::unique_ptr<BarnesHutTree> tree_;
+
+    // Solver::Symmetric: this rank's share of the (I, J <= I) block pairs,
+    // per-thread force buffers over all bodies and their per-rank sum
+    std::vector<std::pair<int, int>> pair_blocks_;
+    std::vector<std::vector<double>> thread_forces_;
+    std::vector<double> rank_forces_;
+
+    // First step run() executes (non-zero after a restart)
+    std::uint64_t start_step_ = 0;
+
+    // Pairwise (or body-cell) interactions evaluated by this rank
+    std::uint64_t interactions_ = 0;
+
+    // forces_x_/forces_y_ belong to the current positions, so the next
+    // leapfrog step can start with its first kick without a force pass
+    bool forces_current_ = false;
+
+    // Block timesteps: each body's level (its step is dt / 2^level, -1 before
+    // its first step), its acceleration when the level was last chosen, the
+    // bodies whose step ends at the current substep and the number of
+    // per-body force evaluations
+    std::vector<int> levels_;
+    std::vector<double> last_acc_x_;
+    std::vector<double> last_acc_y_;
+    std::vector<double> last_acc_z_;
+    std::vector<int> active_;
+    std::uint64_t body_updates_ = 0;
+
+    // Load balancing: each body's cost (interactions it received) and this
+    // rank's time in the force loops since the last repartition, the force
+    // time over the whole run, and what the repartitions did
+    std::vector<double> costs_;
+    double window_seconds_ = 0.0;
+    double force_seconds_ = 0.0;
+    double first_imbalance_ = -1.0;
+    int rebalances_ = 0;
+    std::uint64_t migrated_ = 0;
+
+    // Diagnostics: whether the next full force pass also sums the potential,
+    // whether the sum belongs to the current positions, this rank's share of
+    // the potential energy and the direct solver's per-body sums; the time
+    // series goes to diagnostics_file_ (rank 0), compared against its first row
+    // (after a restart, the first row already in the file)
+    bool potential_due_ = false;
+    bool potential_current_ = false;
+    double potential_energy_ = 0.0;
+    std::vector<double> potential_;
+    std::ofstream diagnostics_file_;
+    Diagnostics first_diagnostics_;
+    int diagnostics_samples_ = 0;
+    double energy_drift_ = 0.0;
+    double momentum_drift_ = 0.0;
+    double angular_momentum_drift_ = 0.0;
+
+    // Space-filling curve ordering: each body's index in input order, whether
+    // the bodies are currently in curve order, and what the sorts cost
+    std::vector<std::uint64_t> ids_;
+    bool curve_ordered_ = false;
+    int sorts_ = 0;
+    double sort_seconds_ = 0.0;
+
+    void exchangePositions();
+    void packLocalPositions();
+    // `active` restricts the update to those local bodies (all when null);
+    // the symmetric solver always computes every body. A pass over every local
+    // body also sums the potential energy while potential_due_ is set.
+    void computeForces(const std::vector<int>* active = nullptr);
+    void computeDirectForces(const std::vector<int>* active = nullptr, Precision precision = Precision::Double,
+                             bool potential = false);
+    template <typename Real>
+    void accumulateTiled(const Real* xs, const Real* ys, const Real* zs, const Real* ms, int n_block,
+                         const std::vector<int>* active, int i_tile, int j_tile, bool potential = false);
+    void updateOrigin();
+    void toFloat(const double* xs, const double* ys, const double* zs, const double* ms, int n, float* out,
+                 std::size_t stride) const;
+    void tuneTiles();
+    void computeSymmetricForces(bool potential = false);
+    void computeTreeForces(const std::vector<int>* active = nullptr, bool potential = false);
+    void reportForceError();
+    void rebalance();
+    void migrate(const std::vector<int>& send_counts, std::vector<std::uint64_t>* keys = nullptr);
+    void sortBodies(std::vector<std::uint64_t>& keys);
+    void reorderByCurve();
+    void restoreInputOrder();
+    void resizeLocalState(int total_bodies);
+    void writeCheckpoint(std::uint64_t step, int steps, double dt);
+    bool openDiagnostics();
+    void noteDiagnostics(const Diagnostics& d);
+    void recordDiagnostics(std::uint64_t step, double dt, double wall_seconds, bool write = true);
+    void advance(double dt);
+    void kickDriftKick(double dt);
+    void blockStep(double dt);
+    int chooseLevel(int i, double dt, int substep);
+    void kick(double dt);
+    void drift(double dt);
 };
 
 } // namespace nbody
\ No newline at end of file
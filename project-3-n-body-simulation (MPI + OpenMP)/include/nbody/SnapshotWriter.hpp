@@ -0,0 +1,73 @@
+#pragma once
+
+#include "nbody/Body.hpp"
+#include "nbody/DomainDecomposition.hpp"
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace nbody {
+
+// Writes snapshots in the binary state format (IO::writeBinary) from a
+// dedicated thread per rank, so the step loop only pays for copying its slice.
+// Every rank pwrite()s its own records into the shared file at the offset of
+// its first body and rank 0 adds the header; the thread
+// makes no MPI calls, so MPI_THREAD_SINGLE is enough.
+class SnapshotWriter {
+public:
+    // At most this many snapshots are staged; submit() waits beyond that
+    static constexpr std::size_t MAX_PENDING = 2;
+
+    SnapshotWriter(const DomainDecomposition& domain, std::string prefix);
+    ~SnapshotWriter();
+
+    SnapshotWriter(const SnapshotWriter&) = delete;
+    SnapshotWriter& operator=(const SnapshotWriter&) = delete;
+
+    // Stages this rank's slice, which starts at global index `first_body`, as
+    // "<prefix>_<step>.nbody"
+    void submit(const SystemState& local_bodies, std::size_t first_body, std::size_t total_bodies, int dimensions,
+                double dt, int steps, std::uint64_t step);
+
+    // Waits for every staged snapshot; throws std::runtime_error if a write failed
+    void finish();
+
+    std::size_t written() const;
+    double stallSeconds() const { return stall_seconds_; }
+
+private:
+    struct Job {
+        std::string filename;
+        std::vector<double> records;
+        std::size_t first_body;
+        std::size_t total_bodies;
+        int dimensions;
+        double dt;
+        int steps;
+        std::uint64_t step;
+    };
+
+    DomainDecomposition domain_;
+    std::string prefix_;
+
+    mutable std::mutex mutex_;
+    std::condition_variable changed_;
+    std::deque<Job> pending_;
+    std::vector<std::vector<double>> spare_;   // record buffers reused between snapshots
+    bool busy_ = false;
+    bool stop_ = false;
+    std::string error_;
+    std::size_t written_ = 0;
+    double stall_seconds_ = 0.0;
+
+    std::thread thread_;
+
+    void loop();
+    void write(const Job& job) const;
+};
+
+} // namespace nbody
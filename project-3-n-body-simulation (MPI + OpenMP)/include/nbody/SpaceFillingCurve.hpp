@@ -0,0 +1,27 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+namespace nbody {
+
+// Keys along space-filling curves over a 2^BITS x 2^BITS grid, so that bodies
+// close in key order are close in space, and the local radix sort used to
+// order bodies by such keys.
+class SpaceFillingCurve {
+public:
+    static constexpr int BITS = 16;
+
+    // Z-order: the bits of ix and iy interleaved (ix in the even bits)
+    static std::uint64_t morton(std::uint32_t ix, std::uint32_t iy);
+
+    // Hilbert curve index; unlike Morton order it never jumps between
+    // distant cells, which keeps key ranges spatially more compact
+    static std::uint64_t hilbert(std::uint32_t ix, std::uint32_t iy);
+
+    // Stable LSD radix sort, one byte per pass: order[k] is the index of the
+    // k-th smallest key. Bytes that are equal in every key are skipped.
+    static void radixOrder(const std::vector<std::uint64_t>& keys, std::vector<int>& order);
+};
+
+} // namespace nbody
@@ -0,0 +1,222 @@
+#include "nbody/BarnesHut.hpp"
+#include "nbody/ForceKernel.hpp"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <numeric>
+
+namespace nbody {
+
+namespace {
+
+// Subtrees with fewer bodies are built by the task that reached them
+constexpr int TASK_CUTOFF = 4096;
+
+} // namespace
+
+BarnesHutTree::BarnesHutTree(double theta, double softening)
+    : theta_(theta), softening_sq_(softening * softening) {}
+
+void BarnesHutTree::build(const BodyPositions& bodies) {
+    const int n = static_cast<int>(bodies.size());
+
+    order_.resize(n);
+    std::iota(order_.begin(), order_.end(), 0);
+    sorted_.resize(n);
+
+    // Generous upper bound; a node that does not fit simply stays a (larger) leaf
+    pool_.resize(std::max(1024, 4 * n));
+    node_count_.store(1);
+
+    double min_x = std::numeric_limits<double>::max();
+    double min_y = std::numeric_limits<double>::max();
+    double max_x = std::numeric_limits<double>::lowest();
+    double max_y = std::numeric_limits<double>::lowest();
+
+    #pragma omp parallel for reduction(min:min_x, min_y) reduction(max:max_x, max_y)
+    for (int i = 0; i < n; ++i) {
+        min_x = std::min(min_x, bodies.x[i]);
+        min_y = std::min(min_y, bodies.y[i]);
+        max_x = std::max(max_x, bodies.x[i]);
+        max_y = std::max(max_y, bodies.y[i]);
+    }
+
+    Node& root = pool_[0];
+    root.cx = n > 0 ? 0.5 * (min_x + max_x) : 0.0;
+    root.cy = n > 0 ? 0.5 * (min_y + max_y) : 0.0;
+    root.half = n > 0 ? 0.5 * std::max(max_x - min_x, max_y - min_y) * (1.0 + 1e-12) : 0.0;
+    if (root.half <= 0.0) root.half = 1.0;
+    root.begin = 0;
+    root.end = n;
+
+    #pragma omp parallel
+    {
+        #pragma omp single
+        buildNode(0, bodies, 0);
+    }
+
+    #pragma omp parallel for schedule(static)
+    for (int k = 0; k < n; ++k) {
+        sorted_.x[k] = bodies.x[order_[k]];
+        sorted_.y[k] = bodies.y[order_[k]];
+        sorted_.mass[k] = bodies.mass[order_[k]];
+    }
+}
+
+void BarnesHutTree::makeLeaf(Node& node, const BodyPositions& bodies) {
+    double mass = 0.0;
+    double mx = 0.0;
+    double my = 0.0;
+    for (int k = node.begin; k < node.end; ++k) {
+        int j = order_[k];
+        mass += bodies.mass[j];
+        mx += bodies.mass[j] * bodies.x[j];
+        my += bodies.mass[j] * bodies.y[j];
+    }
+
+    node.leaf = true;
+    node.mass = mass;
+    node.com_x = mass > 0.0 ? mx / mass : node.cx;
+    node.com_y = mass > 0.0 ? my / mass : node.cy;
+    std::fill(std::begin(node.children), std::end(node.children), -1);
+    setOpeningRadius(node);
+}
+
+// Accept a cell when distance > width / theta + |com - centre| (Barnes 1994), which
+// also stays safe for bodies near the edge of a cell whose mass is off-centre
+void BarnesHutTree::setOpeningRadius(Node& node) const {
+    if (theta_ <= 0.0) {
+        node.open_sq = std::numeric_limits<double>::infinity();
+        return;
+    }
+    double offset = std::hypot(node.com_x - node.cx, node.com_y - node.cy);
+    double radius = 2.0 * node.half / theta_ + offset;
+    node.open_sq = radius * radius;
+}
+
+void BarnesHutTree::buildNode(int index, const BodyPositions& bodies, int depth) {
+    Node& node = pool_[index];
+    const int count = node.end - node.begin;
+
+    if (count <= LEAF_SIZE || depth >= MAX_DEPTH) {
+        makeLeaf(node, bodies);
+        return;
+    }
+
+    // Split the body range into the four quadrants: SW, SE, NW, NE
+    auto first = order_.begin() + node.begin;
+    auto last = order_.begin() + node.end;
+    auto north = std::partition(first, last, [&](int j) { return bodies.y[j] < node.cy; });
+    auto se = std::partition(first, north, [&](int j) { return bodies.x[j] < node.cx; });
+    auto ne = std::partition(north, last, [&](int j) { return bodies.x[j] < node.cx; });
+
+    const int bounds[5] = {
+        node.begin,
+        static_cast<int>(se - order_.begin()),
+        static_cast<int>(north - order_.begin()),
+        static_cast<int>(ne - order_.begin()),
+        node.end
+    };
+
+    int nonempty = 0;
+    for (int q = 0; q < 4; ++q) {
+        if (bounds[q + 1] > bounds[q]) ++nonempty;
+    }
+
+    const int base = node_count_.fetch_add(nonempty);
+    if (base + nonempty > static_cast<int>(pool_.size())) {
+        makeLeaf(node, bodies);
+        return;
+    }
+
+    const double quarter = 0.5 * node.half;
+    int next = base;
+    for (int q = 0; q < 4; ++q) {
+        node.children[q] = -1;
+        if (bounds[q + 1] == bounds[q]) continue;
+
+        Node& child = pool_[next];
+        child.cx = node.cx + ((q & 1) ? quarter : -quarter);
+        child.cy = node.cy + ((q & 2) ? quarter : -quarter);
+        child.half = quarter;
+        child.begin = bounds[q];
+        child.end = bounds[q + 1];
+        node.children[q] = next++;
+    }
+
+    const BodyPositions* source = &bodies;
+    for (int q = 0; q < 4; ++q) {
+        int child = node.children[q];
+        if (child < 0) continue;
+
+        if (pool_[child].end - pool_[child].begin > TASK_CUTOFF) {
+            #pragma omp task firstprivate(child, source, depth)
+            buildNode(child, *source, depth + 1);
+        } else {
+            buildNode(child, bodies, depth + 1);
+        }
+    }
+    #pragma omp taskwait
+
+    double mass = 0.0;
+    double mx = 0.0;
+    double my = 0.0;
+    for (int q = 0; q < 4; ++q) {
+        if (node.children[q] < 0) continue;
+        const Node& child = pool_[node.children[q]];
+        mass += child.mass;
+        mx += child.mass * child.com_x;
+        my += child.mass * child.com_y;
+    }
+
+    node.leaf = false;
+    node.mass = mass;
+    node.com_x = mass > 0.0 ? mx / mass : node.cx;
+    node.com_y = mass > 0.0 ? my / mass : node.cy;
+    setOpeningRadius(node);
+}
+
+std::uint64_t BarnesHutTree::accumulate(double xi, double yi, double& ax, double& ay, double* phi) const {
+    if (sorted_.size() == 0) return 0;
+
+    std::uint64_t interactions = 0;
+
+    // Every level pushes at most four children, so this bound cannot overflow
+    int stack[4 * MAX_DEPTH + 4];
+    int top = 0;
+    stack[top++] = 0;
+
+    while (top > 0) {
+        const Node& node = pool_[stack[--top]];
+
+        if (node.leaf) {
+            std::size_t count = static_cast<std::size_t>(node.end - node.begin);
+            ForceKernel::accumulate(&sorted_.x[node.begin], &sorted_.y[node.begin], &sorted_.mass[node.begin],
+                                    count, xi, yi, softening_sq_, ax, ay, phi);
+            interactions += count;
+            continue;
+        }
+
+        double dx = node.com_x - xi;
+        double dy = node.com_y - yi;
+        double dist_sq = dx*dx + dy*dy;
+
+        if (dist_sq > node.open_sq) {
+            double inv_dist = 1.0 / std::sqrt(dist_sq + softening_sq_);
+            double s = node.mass * inv_dist * inv_dist * inv_dist;
+            ax += s * dx;
+            ay += s * dy;
+            if (phi) *phi += node.mass * inv_dist;
+            ++interactions;
+            continue;
+        }
+
+        for (int q = 0; q < 4; ++q) {
+            if (node.children[q] >= 0) stack[top++] = node.children[q];
+        }
+    }
+
+    return interactions;
+}
+
+} // namespace nbody
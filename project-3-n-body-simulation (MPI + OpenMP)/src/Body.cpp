@@ -9,26 +9,28 @@ MPI_Datatype Body::mpiType() {
     
     if (type == MPI_DATATYPE_NULL) {
         // 1. Describe the internal structure
-        int block_lengths[5] = {1, 1, 1, 1, 1};
-        MPI_Aint displacements[5];
-        MPI_Datatype types[5] = {MPI_DOUBLE, MPI_DOUBLE, MPI_DOUBLE, MPI_DOUBLE, MPI_DOUBLE};
+        int block_lengths[7] = {1, 1, 1, 1, 1, 1, 1};
+        MPI_Aint displacements[7];
+        MPI_Datatype types[7] = {MPI_DOUBLE, MPI_DOUBLE, MPI_DOUBLE, MPI_DOUBLE, MPI_DOUBLE, MPI_DOUBLE, MPI_DOUBLE};
 
         // FIX: Zero-initialize to silence warnings about uninitialized usage in Get_address
         Body dummy{}; 
         
         MPI_Get_address(&dummy.x, &displacements[0]);
         MPI_Get_address(&dummy.y, &displacements[1]);
-        MPI_Get_address(&dummy.vx, &displacements[2]);
-        MPI_Get_address(&dummy.vy, &displacements[3]);
-        MPI_Get_address(&dummy.mass, &displacements[4]);
+        MPI_Get_address(&dummy.z, &displacements[2]);
+        MPI_Get_address(&dummy.vx, &displacements[3]);
+        MPI_Get_address(&dummy.vy, &displacements[4]);
+        MPI_Get_address(&dummy.vz, &displacements[5]);
+        MPI_Get_address(&dummy.mass, &displacements[6]);
 
         // Normalize relative to base address
         MPI_Aint base;
         MPI_Get_address(&dummy, &base);
-        for(int i=0; i<5; i++) displacements[i] -= base;
+        for(int i=0; i<7; i++) displacements[i] -= base;
 
         MPI_Datatype temp_type;
-        MPI_Type_create_struct(5, block_lengths, displacements, types, &temp_type);
+        MPI_Type_create_struct(7, block_lengths, displacements, types, &temp_type);
 
         // 2. Resize to handle alignment/padding
         MPI_Type_create_resized(temp_type, 0, sizeof(Body), &type);
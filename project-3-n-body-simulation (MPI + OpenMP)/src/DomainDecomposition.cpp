@@ -1,5 +1,6 @@
 #include "nbody/DomainDecomposition.hpp"
 #include <numeric>
+#include <stdexcept>
 
 namespace nbody {
 
@@ -7,6 +8,10 @@ DomainDecomposition::DomainDecomposition(int rank, int size)
     : rank_(rank), size_(size) {}
 
 std::size_t DomainDecomposition::getLocalStart(std::size_t total_bodies) const {
+    if (!counts_.empty() && static_cast<long long>(total_bodies) == counts_total_) {
+        return static_cast<std::size_t>(std::accumulate(counts_.begin(), counts_.begin() + rank_, 0LL));
+    }
+
     std::size_t remainder = total_bodies % size_;
     std::size_t count = total_bodies / size_;
     
@@ -18,6 +23,10 @@ std::size_t DomainDecomposition::getLocalStart(std::size_t total_bodies) const {
 }
 
 std::size_t DomainDecomposition::getLocalCount(std::size_t total_bodies) const {
+    if (!counts_.empty() && static_cast<long long>(total_bodies) == counts_total_) {
+        return static_cast<std::size_t>(counts_[rank_]);
+    }
+
     std::size_t remainder = total_bodies % size_;
     std::size_t count = total_bodies / size_;
     
@@ -31,6 +40,12 @@ std::pair<std::vector<int>, std::vector<int>> DomainDecomposition::getcv(int tot
     std::vector<int> counts(size_);
     std::vector<int> displs(size_);
 
+    if (!counts_.empty() && total_bodies == counts_total_) {
+        counts = counts_;
+        std::exclusive_scan(counts.begin(), counts.end(), displs.begin(), 0);
+        return {counts, displs};
+    }
+
     int current_disp = 0;
     int remainder = total_bodies % size_;
     int count = total_bodies / size_;
@@ -47,4 +62,12 @@ std::pair<std::vector<int>, std::vector<int>> DomainDecomposition::getcv(int tot
     return {counts, displs};
 }
 
-} // namespace nbody
\ No newline at end of file
+void DomainDecomposition::setCounts(const std::vector<int>& counts) {
+    if (!counts.empty() && static_cast<int>(counts.size()) != size_) {
+        throw std::invalid_argument("DomainDecomposition::setCounts needs one count per rank");
+    }
+    counts_ = counts;
+    counts_total_ = std::accumulate(counts_.begin(), counts_.end(), 0LL);
+}
+
+} // namespace nbody
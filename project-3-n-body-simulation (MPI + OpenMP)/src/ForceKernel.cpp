@@ -0,0 +1,734 @@
+#include "nbody/ForceKernel.hpp"
+#include <cfloat>
+#include <cmath>
+#include <type_traits>
+
+// The intrinsics path follows the target ISA (e.g. -march=native in the release preset)
+#if defined(NBODY_SIMD_INTRINSICS) && defined(__AVX512F__)
+#define NBODY_KERNEL_AVX512
+#elif defined(NBODY_SIMD_INTRINSICS) && defined(__AVX2__) && defined(__FMA__)
+#define NBODY_KERNEL_AVX2
+#endif
+
+#if defined(NBODY_KERNEL_AVX512) || defined(NBODY_KERNEL_AVX2)
+#include <immintrin.h>
+#endif
+
+namespace nbody {
+
+namespace {
+
+// Every kernel below is a template on the dimension Dim (2 or 3): the z terms
+// are compiled in only for 3, and with 2 the z arrays and az are never touched
+// (they are null). The softening is a broadcast operand like the target
+// positions, so neither the dimension nor the softening costs a branch per pair.
+//
+// The target itself is the one body whose squared distance is the softening
+// alone. A lane mask (a select in the portable path) keyed on that drops it
+// from the sums: with a small softening its 1 / softening^3 overflows, and the
+// inf * 0 of its zero separation would turn every sum into NaN.
+//
+// With Potential the kernels also sum m_j / |r_j - r_i| (softened) into phi,
+// reusing the inverse distance and the self mask of the force term.
+
+// Portable path, also used for the tail of the intrinsics loops. Real is the
+// precision of the pair terms and of the sum over [begin, end); the sum is
+// then added to the double accumulators.
+template <int Dim, bool Potential, typename Real>
+void accumulateScalar(const Real* x, const Real* y, const Real* z, const Real* mass, std::size_t begin,
+                      std::size_t end, Real xi, Real yi, Real zi, Real eps, double* ax, double* ay, double* az,
+                      double* phi) {
+    Real sx = 0;
+    Real sy = 0;
+    [[maybe_unused]] Real sz = 0;
+    [[maybe_unused]] Real sp = 0;
+
+    #pragma omp simd reduction(+:sx, sy, sz, sp)
+    for (std::size_t j = begin; j < end; ++j) {
+        Real dx = x[j] - xi;
+        Real dy = y[j] - yi;
+        Real dist_sq = dx*dx + dy*dy + eps;
+        [[maybe_unused]] Real dz = 0;
+        if constexpr (Dim == 3) {
+            dz = z[j] - zi;
+            dist_sq += dz*dz;
+        }
+        const bool other = dist_sq > eps;
+        Real inv_dist = Real(1) / std::sqrt(dist_sq);
+        Real s = other ? mass[j] * inv_dist * inv_dist * inv_dist : Real(0);
+        sx += s * dx;
+        sy += s * dy;
+        if constexpr (Dim == 3) sz += s * dz;
+        if constexpr (Potential) sp += other ? mass[j] * inv_dist : Real(0);
+    }
+
+    *ax += sx;
+    *ay += sy;
+    if constexpr (Dim == 3) *az += sz;
+    if constexpr (Potential) *phi += sp;
+}
+
+constexpr std::size_t R = ForceKernel::TARGET_BLOCK;
+
+// Portable register block, also used for the tail of the intrinsics loops
+template <int Dim, bool Potential, typename Real>
+void accumulateBlockScalar(const Real* x, const Real* y, const Real* z, const Real* mass, std::size_t begin,
+                           std::size_t end, const Real* xi, const Real* yi, const Real* zi, Real eps,
+                           double* ax, double* ay, double* az, double* phi) {
+    Real sx[R] = {};
+    Real sy[R] = {};
+    [[maybe_unused]] Real sz[R] = {};
+    [[maybe_unused]] Real sp[R] = {};
+
+    #pragma omp simd reduction(+:sx[:R], sy[:R], sz[:R], sp[:R])
+    for (std::size_t j = begin; j < end; ++j) {
+        for (std::size_t r = 0; r < R; ++r) {
+            Real dx = x[j] - xi[r];
+            Real dy = y[j] - yi[r];
+            Real dist_sq = dx*dx + dy*dy + eps;
+            [[maybe_unused]] Real dz = 0;
+            if constexpr (Dim == 3) {
+                dz = z[j] - zi[r];
+                dist_sq += dz*dz;
+            }
+            const bool other = dist_sq > eps;
+            Real inv_dist = Real(1) / std::sqrt(dist_sq);
+            Real s = other ? mass[j] * inv_dist * inv_dist * inv_dist : Real(0);
+            sx[r] += s * dx;
+            sy[r] += s * dy;
+            if constexpr (Dim == 3) sz[r] += s * dz;
+            if constexpr (Potential) sp[r] += other ? mass[j] * inv_dist : Real(0);
+        }
+    }
+
+    for (std::size_t r = 0; r < R; ++r) {
+        ax[r] += sx[r];
+        ay[r] += sy[r];
+        if constexpr (Dim == 3) az[r] += sz[r];
+        if constexpr (Potential) phi[r] += sp[r];
+    }
+}
+
+#if defined(NBODY_KERNEL_AVX512)
+
+// The zero-masked forms are used because GCC 12 warns about the
+// _mm512_undefined_pd() source operand of the unmasked ones.
+constexpr __mmask8 ALL_LANES = 0xFF;
+
+inline double horizontalSum(__m512d v) {
+    __m256d lo = _mm512_maskz_extractf64x4_pd(ALL_LANES, v, 0);
+    __m256d hi = _mm512_maskz_extractf64x4_pd(ALL_LANES, v, 1);
+    __m256d sum4 = _mm256_add_pd(lo, hi);
+    __m128d sum2 = _mm_add_pd(_mm256_castpd256_pd128(sum4), _mm256_extractf128_pd(sum4, 1));
+    return _mm_cvtsd_f64(_mm_add_sd(sum2, _mm_unpackhi_pd(sum2, sum2)));
+}
+
+inline __m512d invSqrt(__m512d v) {
+#ifdef NBODY_FAST_RSQRT
+    // 14-bit estimate, two Newton steps: y <- y * (1.5 - 0.5 * v * y^2)
+    const __m512d half = _mm512_set1_pd(0.5);
+    const __m512d three_halves = _mm512_set1_pd(1.5);
+    __m512d y = _mm512_maskz_rsqrt14_pd(ALL_LANES, v);
+    __m512d hv = _mm512_mul_pd(half, v);
+    y = _mm512_mul_pd(y, _mm512_fnmadd_pd(hv, _mm512_mul_pd(y, y), three_halves));
+    y = _mm512_mul_pd(y, _mm512_fnmadd_pd(hv, _mm512_mul_pd(y, y), three_halves));
+    return y;
+#else
+    return _mm512_div_pd(_mm512_set1_pd(1.0), _mm512_maskz_sqrt_pd(ALL_LANES, v));
+#endif
+}
+
+template <int Dim, bool Potential>
+void accumulateSimd(const double* x, const double* y, const double* z, const double* mass, std::size_t n,
+                    double xi, double yi, double zi, double softening_sq, double* ax, double* ay, double* az,
+                    double* phi) {
+    const __m512d vxi = _mm512_set1_pd(xi);
+    const __m512d vyi = _mm512_set1_pd(yi);
+    const __m512d vzi = _mm512_set1_pd(zi);
+    const __m512d eps = _mm512_set1_pd(softening_sq);
+    __m512d sx = _mm512_setzero_pd();
+    __m512d sy = _mm512_setzero_pd();
+    __m512d sz = _mm512_setzero_pd();
+    __m512d sp = _mm512_setzero_pd();
+
+    std::size_t j = 0;
+    for (; j + 8 <= n; j += 8) {
+        const __m512d mj = _mm512_loadu_pd(mass + j);
+        __m512d dx = _mm512_sub_pd(_mm512_loadu_pd(x + j), vxi);
+        __m512d dy = _mm512_sub_pd(_mm512_loadu_pd(y + j), vyi);
+        __m512d dz = _mm512_setzero_pd();
+        __m512d dist_sq = eps;
+        if constexpr (Dim == 3) {
+            dz = _mm512_sub_pd(_mm512_loadu_pd(z + j), vzi);
+            dist_sq = _mm512_fmadd_pd(dz, dz, dist_sq);
+        }
+        dist_sq = _mm512_fmadd_pd(dx, dx, _mm512_fmadd_pd(dy, dy, dist_sq));
+        __m512d inv_dist = invSqrt(dist_sq);
+        const __mmask8 other = _mm512_cmp_pd_mask(dist_sq, eps, _CMP_GT_OQ);
+        __m512d s = _mm512_maskz_mul_pd(other, mj, _mm512_mul_pd(inv_dist, _mm512_mul_pd(inv_dist, inv_dist)));
+        sx = _mm512_fmadd_pd(s, dx, sx);
+        sy = _mm512_fmadd_pd(s, dy, sy);
+        if constexpr (Dim == 3) sz = _mm512_fmadd_pd(s, dz, sz);
+        if constexpr (Potential) sp = _mm512_mask3_fmadd_pd(mj, inv_dist, sp, other);
+    }
+
+    *ax += horizontalSum(sx);
+    *ay += horizontalSum(sy);
+    if constexpr (Dim == 3) *az += horizontalSum(sz);
+    if constexpr (Potential) *phi += horizontalSum(sp);
+    accumulateScalar<Dim, Potential>(x, y, z, mass, j, n, xi, yi, zi, softening_sq, ax, ay, az, phi);
+}
+
+// 4 targets x 8 bodies per iteration: 8 accumulators (12 in 3D, 4 more with
+// the potential) plus the shared loads stay within the 32 zmm registers
+template <int Dim, bool Potential>
+void accumulateBlockSimd(const double* x, const double* y, const double* z, const double* mass, std::size_t n,
+                         const double* xi, const double* yi, const double* zi, double softening_sq,
+                         double* ax, double* ay, double* az, double* phi) {
+    const __m512d eps = _mm512_set1_pd(softening_sq);
+    __m512d vxi[R], vyi[R], vzi[R], sx[R], sy[R], sz[R], sp[R];
+    for (std::size_t r = 0; r < R; ++r) {
+        vxi[r] = _mm512_set1_pd(xi[r]);
+        vyi[r] = _mm512_set1_pd(yi[r]);
+        vzi[r] = Dim == 3 ? _mm512_set1_pd(zi[r]) : _mm512_setzero_pd();
+        sx[r] = _mm512_setzero_pd();
+        sy[r] = _mm512_setzero_pd();
+        sz[r] = _mm512_setzero_pd();
+        sp[r] = _mm512_setzero_pd();
+    }
+
+    std::size_t j = 0;
+    for (; j + 8 <= n; j += 8) {
+        const __m512d xj = _mm512_loadu_pd(x + j);
+        const __m512d yj = _mm512_loadu_pd(y + j);
+        const __m512d zj = Dim == 3 ? _mm512_loadu_pd(z + j) : _mm512_setzero_pd();
+        const __m512d mj = _mm512_loadu_pd(mass + j);
+        for (std::size_t r = 0; r < R; ++r) {
+            __m512d dx = _mm512_sub_pd(xj, vxi[r]);
+            __m512d dy = _mm512_sub_pd(yj, vyi[r]);
+            __m512d dz = _mm512_setzero_pd();
+            __m512d dist_sq = eps;
+            if constexpr (Dim == 3) {
+                dz = _mm512_sub_pd(zj, vzi[r]);
+                dist_sq = _mm512_fmadd_pd(dz, dz, dist_sq);
+            }
+            dist_sq = _mm512_fmadd_pd(dx, dx, _mm512_fmadd_pd(dy, dy, dist_sq));
+            __m512d inv_dist = invSqrt(dist_sq);
+            const __mmask8 other = _mm512_cmp_pd_mask(dist_sq, eps, _CMP_GT_OQ);
+            __m512d s = _mm512_maskz_mul_pd(other, mj, _mm512_mul_pd(inv_dist, _mm512_mul_pd(inv_dist, inv_dist)));
+            sx[r] = _mm512_fmadd_pd(s, dx, sx[r]);
+            sy[r] = _mm512_fmadd_pd(s, dy, sy[r]);
+            if constexpr (Dim == 3) sz[r] = _mm512_fmadd_pd(s, dz, sz[r]);
+            if constexpr (Potential) sp[r] = _mm512_mask3_fmadd_pd(mj, inv_dist, sp[r], other);
+        }
+    }
+
+    for (std::size_t r = 0; r < R; ++r) {
+        ax[r] += horizontalSum(sx[r]);
+        ay[r] += horizontalSum(sy[r]);
+        if constexpr (Dim == 3) az[r] += horizontalSum(sz[r]);
+        if constexpr (Potential) phi[r] += horizontalSum(sp[r]);
+    }
+    accumulateBlockScalar<Dim, Potential>(x, y, z, mass, j, n, xi, yi, zi, softening_sq, ax, ay, az, phi);
+}
+
+// Mixed precision: 16 float lanes per vector; the lane sums are widened to
+// double before the horizontal add
+inline __m512 invSqrt(__m512 v) {
+#ifdef NBODY_FAST_RSQRT
+    // 14-bit estimate, one Newton step reaches float precision
+    __m512 y = _mm512_maskz_rsqrt14_ps(0xFFFF, v);
+    __m512 hv = _mm512_mul_ps(_mm512_set1_ps(0.5f), v);
+    return _mm512_mul_ps(y, _mm512_fnmadd_ps(hv, _mm512_mul_ps(y, y), _mm512_set1_ps(1.5f)));
+#else
+    return _mm512_div_ps(_mm512_set1_ps(1.0f), _mm512_maskz_sqrt_ps(0xFFFF, v));
+#endif
+}
+
+inline double horizontalSum(__m512 v) {
+    __m256 lo = _mm256_castpd_ps(_mm512_maskz_extractf64x4_pd(ALL_LANES, _mm512_castps_pd(v), 0));
+    __m256 hi = _mm256_castpd_ps(_mm512_maskz_extractf64x4_pd(ALL_LANES, _mm512_castps_pd(v), 1));
+    return horizontalSum(_mm512_add_pd(_mm512_maskz_cvtps_pd(ALL_LANES, lo), _mm512_maskz_cvtps_pd(ALL_LANES, hi)));
+}
+
+template <int Dim, bool Potential>
+void accumulateSimd(const float* x, const float* y, const float* z, const float* mass, std::size_t n,
+                    float xi, float yi, float zi, float softening_sq, double* ax, double* ay, double* az,
+                    double* phi) {
+    const __m512 vxi = _mm512_set1_ps(xi);
+    const __m512 vyi = _mm512_set1_ps(yi);
+    const __m512 vzi = _mm512_set1_ps(zi);
+    const __m512 eps = _mm512_set1_ps(softening_sq);
+    __m512 sx = _mm512_setzero_ps();
+    __m512 sy = _mm512_setzero_ps();
+    __m512 sz = _mm512_setzero_ps();
+    __m512 sp = _mm512_setzero_ps();
+
+    std::size_t j = 0;
+    for (; j + 16 <= n; j += 16) {
+        const __m512 mj = _mm512_loadu_ps(mass + j);
+        __m512 dx = _mm512_sub_ps(_mm512_loadu_ps(x + j), vxi);
+        __m512 dy = _mm512_sub_ps(_mm512_loadu_ps(y + j), vyi);
+        __m512 dz = _mm512_setzero_ps();
+        __m512 dist_sq = eps;
+        if constexpr (Dim == 3) {
+            dz = _mm512_sub_ps(_mm512_loadu_ps(z + j), vzi);
+            dist_sq = _mm512_fmadd_ps(dz, dz, dist_sq);
+        }
+        dist_sq = _mm512_fmadd_ps(dx, dx, _mm512_fmadd_ps(dy, dy, dist_sq));
+        __m512 inv_dist = invSqrt(dist_sq);
+        const __mmask16 other = _mm512_cmp_ps_mask(dist_sq, eps, _CMP_GT_OQ);
+        __m512 s = _mm512_maskz_mul_ps(other, mj, _mm512_mul_ps(inv_dist, _mm512_mul_ps(inv_dist, inv_dist)));
+        sx = _mm512_fmadd_ps(s, dx, sx);
+        sy = _mm512_fmadd_ps(s, dy, sy);
+        if constexpr (Dim == 3) sz = _mm512_fmadd_ps(s, dz, sz);
+        if constexpr (Potential) sp = _mm512_mask3_fmadd_ps(mj, inv_dist, sp, other);
+    }
+
+    *ax += horizontalSum(sx);
+    *ay += horizontalSum(sy);
+    if constexpr (Dim == 3) *az += horizontalSum(sz);
+    if constexpr (Potential) *phi += horizontalSum(sp);
+    accumulateScalar<Dim, Potential>(x, y, z, mass, j, n, xi, yi, zi, softening_sq, ax, ay, az, phi);
+}
+
+template <int Dim, bool Potential>
+void accumulateBlockSimd(const float* x, const float* y, const float* z, const float* mass, std::size_t n,
+                         const float* xi, const float* yi, const float* zi, float softening_sq,
+                         double* ax, double* ay, double* az, double* phi) {
+    const __m512 eps = _mm512_set1_ps(softening_sq);
+    __m512 vxi[R], vyi[R], vzi[R], sx[R], sy[R], sz[R], sp[R];
+    for (std::size_t r = 0; r < R; ++r) {
+        vxi[r] = _mm512_set1_ps(xi[r]);
+        vyi[r] = _mm512_set1_ps(yi[r]);
+        vzi[r] = Dim == 3 ? _mm512_set1_ps(zi[r]) : _mm512_setzero_ps();
+        sx[r] = _mm512_setzero_ps();
+        sy[r] = _mm512_setzero_ps();
+        sz[r] = _mm512_setzero_ps();
+        sp[r] = _mm512_setzero_ps();
+    }
+
+    std::size_t j = 0;
+    for (; j + 16 <= n; j += 16) {
+        const __m512 xj = _mm512_loadu_ps(x + j);
+        const __m512 yj = _mm512_loadu_ps(y + j);
+        const __m512 zj = Dim == 3 ? _mm512_loadu_ps(z + j) : _mm512_setzero_ps();
+        const __m512 mj = _mm512_loadu_ps(mass + j);
+        for (std::size_t r = 0; r < R; ++r) {
+            __m512 dx = _mm512_sub_ps(xj, vxi[r]);
+            __m512 dy = _mm512_sub_ps(yj, vyi[r]);
+            __m512 dz = _mm512_setzero_ps();
+            __m512 dist_sq = eps;
+            if constexpr (Dim == 3) {
+                dz = _mm512_sub_ps(zj, vzi[r]);
+                dist_sq = _mm512_fmadd_ps(dz, dz, dist_sq);
+            }
+            dist_sq = _mm512_fmadd_ps(dx, dx, _mm512_fmadd_ps(dy, dy, dist_sq));
+            __m512 inv_dist = invSqrt(dist_sq);
+            const __mmask16 other = _mm512_cmp_ps_mask(dist_sq, eps, _CMP_GT_OQ);
+            __m512 s = _mm512_maskz_mul_ps(other, mj, _mm512_mul_ps(inv_dist, _mm512_mul_ps(inv_dist, inv_dist)));
+            sx[r] = _mm512_fmadd_ps(s, dx, sx[r]);
+            sy[r] = _mm512_fmadd_ps(s, dy, sy[r]);
+            if constexpr (Dim == 3) sz[r] = _mm512_fmadd_ps(s, dz, sz[r]);
+            if constexpr (Potential) sp[r] = _mm512_mask3_fmadd_ps(mj, inv_dist, sp[r], other);
+        }
+    }
+
+    for (std::size_t r = 0; r < R; ++r) {
+        ax[r] += horizontalSum(sx[r]);
+        ay[r] += horizontalSum(sy[r]);
+        if constexpr (Dim == 3) az[r] += horizontalSum(sz[r]);
+        if constexpr (Potential) phi[r] += horizontalSum(sp[r]);
+    }
+    accumulateBlockScalar<Dim, Potential>(x, y, z, mass, j, n, xi, yi, zi, softening_sq, ax, ay, az, phi);
+}
+
+#elif defined(NBODY_KERNEL_AVX2)
+
+inline __m256d invSqrt(__m256d v) {
+#ifdef NBODY_FAST_RSQRT
+    // 12-bit single precision estimate, two Newton steps in double precision.
+    // The estimate's input is clamped to FLT_MIN: a smaller v would round to
+    // zero in float, and the infinite estimate would make the steps NaN.
+    const __m256d half = _mm256_set1_pd(0.5);
+    const __m256d three_halves = _mm256_set1_pd(1.5);
+    const __m256d v_min = _mm256_set1_pd(FLT_MIN);
+    __m256d y = _mm256_cvtps_pd(_mm_rsqrt_ps(_mm256_cvtpd_ps(_mm256_max_pd(v, v_min))));
+    __m256d hv = _mm256_mul_pd(half, v);
+    y = _mm256_mul_pd(y, _mm256_fnmadd_pd(hv, _mm256_mul_pd(y, y), three_halves));
+    y = _mm256_mul_pd(y, _mm256_fnmadd_pd(hv, _mm256_mul_pd(y, y), three_halves));
+    return y;
+#else
+    return _mm256_div_pd(_mm256_set1_pd(1.0), _mm256_sqrt_pd(v));
+#endif
+}
+
+inline double horizontalSum(__m256d v) {
+    __m128d lo = _mm256_castpd256_pd128(v);
+    __m128d hi = _mm256_extractf128_pd(v, 1);
+    lo = _mm_add_pd(lo, hi);
+    return _mm_cvtsd_f64(_mm_add_sd(lo, _mm_unpackhi_pd(lo, lo)));
+}
+
+template <int Dim, bool Potential>
+void accumulateSimd(const double* x, const double* y, const double* z, const double* mass, std::size_t n,
+                    double xi, double yi, double zi, double softening_sq, double* ax, double* ay, double* az,
+                    double* phi) {
+    const __m256d vxi = _mm256_set1_pd(xi);
+    const __m256d vyi = _mm256_set1_pd(yi);
+    const __m256d vzi = _mm256_set1_pd(zi);
+    const __m256d eps = _mm256_set1_pd(softening_sq);
+    __m256d sx = _mm256_setzero_pd();
+    __m256d sy = _mm256_setzero_pd();
+    __m256d sz = _mm256_setzero_pd();
+    __m256d sp = _mm256_setzero_pd();
+
+    std::size_t j = 0;
+    for (; j + 4 <= n; j += 4) {
+        const __m256d mj = _mm256_loadu_pd(mass + j);
+        __m256d dx = _mm256_sub_pd(_mm256_loadu_pd(x + j), vxi);
+        __m256d dy = _mm256_sub_pd(_mm256_loadu_pd(y + j), vyi);
+        __m256d dz = _mm256_setzero_pd();
+        __m256d dist_sq = eps;
+        if constexpr (Dim == 3) {
+            dz = _mm256_sub_pd(_mm256_loadu_pd(z + j), vzi);
+            dist_sq = _mm256_fmadd_pd(dz, dz, dist_sq);
+        }
+        dist_sq = _mm256_fmadd_pd(dx, dx, _mm256_fmadd_pd(dy, dy, dist_sq));
+        __m256d inv_dist = invSqrt(dist_sq);
+        const __m256d other = _mm256_cmp_pd(dist_sq, eps, _CMP_GT_OQ);
+        __m256d s = _mm256_and_pd(other, _mm256_mul_pd(mj, _mm256_mul_pd(inv_dist, _mm256_mul_pd(inv_dist, inv_dist))));
+        sx = _mm256_fmadd_pd(s, dx, sx);
+        sy = _mm256_fmadd_pd(s, dy, sy);
+        if constexpr (Dim == 3) sz = _mm256_fmadd_pd(s, dz, sz);
+        if constexpr (Potential) sp = _mm256_add_pd(sp, _mm256_and_pd(other, _mm256_mul_pd(mj, inv_dist)));
+    }
+
+    *ax += horizontalSum(sx);
+    *ay += horizontalSum(sy);
+    if constexpr (Dim == 3) *az += horizontalSum(sz);
+    if constexpr (Potential) *phi += horizontalSum(sp);
+    accumulateScalar<Dim, Potential>(x, y, z, mass, j, n, xi, yi, zi, softening_sq, ax, ay, az, phi);
+}
+
+// 4 targets x 4 bodies per iteration: 8 accumulators and the shared loads
+// leave room for the temporaries in 16 ymm registers (3D and the potential
+// spill some)
+template <int Dim, bool Potential>
+void accumulateBlockSimd(const double* x, const double* y, const double* z, const double* mass, std::size_t n,
+                         const double* xi, const double* yi, const double* zi, double softening_sq,
+                         double* ax, double* ay, double* az, double* phi) {
+    const __m256d eps = _mm256_set1_pd(softening_sq);
+    __m256d sx[R], sy[R], sz[R], sp[R];
+    for (std::size_t r = 0; r < R; ++r) {
+        sx[r] = _mm256_setzero_pd();
+        sy[r] = _mm256_setzero_pd();
+        sz[r] = _mm256_setzero_pd();
+        sp[r] = _mm256_setzero_pd();
+    }
+
+    std::size_t j = 0;
+    for (; j + 4 <= n; j += 4) {
+        const __m256d xj = _mm256_loadu_pd(x + j);
+        const __m256d yj = _mm256_loadu_pd(y + j);
+        const __m256d zj = Dim == 3 ? _mm256_loadu_pd(z + j) : _mm256_setzero_pd();
+        const __m256d mj = _mm256_loadu_pd(mass + j);
+        for (std::size_t r = 0; r < R; ++r) {
+            __m256d dx = _mm256_sub_pd(xj, _mm256_set1_pd(xi[r]));
+            __m256d dy = _mm256_sub_pd(yj, _mm256_set1_pd(yi[r]));
+            __m256d dz = _mm256_setzero_pd();
+            __m256d dist_sq = eps;
+            if constexpr (Dim == 3) {
+                dz = _mm256_sub_pd(zj, _mm256_set1_pd(zi[r]));
+                dist_sq = _mm256_fmadd_pd(dz, dz, dist_sq);
+            }
+            dist_sq = _mm256_fmadd_pd(dx, dx, _mm256_fmadd_pd(dy, dy, dist_sq));
+            __m256d inv_dist = invSqrt(dist_sq);
+            const __m256d other = _mm256_cmp_pd(dist_sq, eps, _CMP_GT_OQ);
+            __m256d s = _mm256_and_pd(other, _mm256_mul_pd(mj, _mm256_mul_pd(inv_dist, _mm256_mul_pd(inv_dist, inv_dist))));
+            sx[r] = _mm256_fmadd_pd(s, dx, sx[r]);
+            sy[r] = _mm256_fmadd_pd(s, dy, sy[r]);
+            if constexpr (Dim == 3) sz[r] = _mm256_fmadd_pd(s, dz, sz[r]);
+            if constexpr (Potential) sp[r] = _mm256_add_pd(sp[r], _mm256_and_pd(other, _mm256_mul_pd(mj, inv_dist)));
+        }
+    }
+
+    for (std::size_t r = 0; r < R; ++r) {
+        ax[r] += horizontalSum(sx[r]);
+        ay[r] += horizontalSum(sy[r]);
+        if constexpr (Dim == 3) az[r] += horizontalSum(sz[r]);
+        if constexpr (Potential) phi[r] += horizontalSum(sp[r]);
+    }
+    accumulateBlockScalar<Dim, Potential>(x, y, z, mass, j, n, xi, yi, zi, softening_sq, ax, ay, az, phi);
+}
+
+// Mixed precision: 8 float lanes per vector; the lane sums are widened to
+// double before the horizontal add
+inline __m256 invSqrt(__m256 v) {
+#ifdef NBODY_FAST_RSQRT
+    // 12-bit estimate, one Newton step reaches float precision
+    __m256 y = _mm256_rsqrt_ps(v);
+    __m256 hv = _mm256_mul_ps(_mm256_set1_ps(0.5f), v);
+    return _mm256_mul_ps(y, _mm256_fnmadd_ps(hv, _mm256_mul_ps(y, y), _mm256_set1_ps(1.5f)));
+#else
+    return _mm256_div_ps(_mm256_set1_ps(1.0f), _mm256_sqrt_ps(v));
+#endif
+}
+
+inline double horizontalSum(__m256 v) {
+    __m256d lo = _mm256_cvtps_pd(_mm256_castps256_ps128(v));
+    __m256d hi = _mm256_cvtps_pd(_mm256_extractf128_ps(v, 1));
+    return horizontalSum(_mm256_add_pd(lo, hi));
+}
+
+template <int Dim, bool Potential>
+void accumulateSimd(const float* x, const float* y, const float* z, const float* mass, std::size_t n,
+                    float xi, float yi, float zi, float softening_sq, double* ax, double* ay, double* az,
+                    double* phi) {
+    const __m256 vxi = _mm256_set1_ps(xi);
+    const __m256 vyi = _mm256_set1_ps(yi);
+    const __m256 vzi = _mm256_set1_ps(zi);
+    const __m256 eps = _mm256_set1_ps(softening_sq);
+    __m256 sx = _mm256_setzero_ps();
+    __m256 sy = _mm256_setzero_ps();
+    __m256 sz = _mm256_setzero_ps();
+    __m256 sp = _mm256_setzero_ps();
+
+    std::size_t j = 0;
+    for (; j + 8 <= n; j += 8) {
+        const __m256 mj = _mm256_loadu_ps(mass + j);
+        __m256 dx = _mm256_sub_ps(_mm256_loadu_ps(x + j), vxi);
+        __m256 dy = _mm256_sub_ps(_mm256_loadu_ps(y + j), vyi);
+        __m256 dz = _mm256_setzero_ps();
+        __m256 dist_sq = eps;
+        if constexpr (Dim == 3) {
+            dz = _mm256_sub_ps(_mm256_loadu_ps(z + j), vzi);
+            dist_sq = _mm256_fmadd_ps(dz, dz, dist_sq);
+        }
+        dist_sq = _mm256_fmadd_ps(dx, dx, _mm256_fmadd_ps(dy, dy, dist_sq));
+        __m256 inv_dist = invSqrt(dist_sq);
+        const __m256 other = _mm256_cmp_ps(dist_sq, eps, _CMP_GT_OQ);
+        __m256 s = _mm256_and_ps(other, _mm256_mul_ps(mj, _mm256_mul_ps(inv_dist, _mm256_mul_ps(inv_dist, inv_dist))));
+        sx = _mm256_fmadd_ps(s, dx, sx);
+        sy = _mm256_fmadd_ps(s, dy, sy);
+        if constexpr (Dim == 3) sz = _mm256_fmadd_ps(s, dz, sz);
+        if constexpr (Potential) sp = _mm256_add_ps(sp, _mm256_and_ps(other, _mm256_mul_ps(mj, inv_dist)));
+    }
+
+    *ax += horizontalSum(sx);
+    *ay += horizontalSum(sy);
+    if constexpr (Dim == 3) *az += horizontalSum(sz);
+    if constexpr (Potential) *phi += horizontalSum(sp);
+    accumulateScalar<Dim, Potential>(x, y, z, mass, j, n, xi, yi, zi, softening_sq, ax, ay, az, phi);
+}
+
+template <int Dim, bool Potential>
+void accumulateBlockSimd(const float* x, const float* y, const float* z, const float* mass, std::size_t n,
+                         const float* xi, const float* yi, const float* zi, float softening_sq,
+                         double* ax, double* ay, double* az, double* phi) {
+    const __m256 eps = _mm256_set1_ps(softening_sq);
+    __m256 sx[R], sy[R], sz[R], sp[R];
+    for (std::size_t r = 0; r < R; ++r) {
+        sx[r] = _mm256_setzero_ps();
+        sy[r] = _mm256_setzero_ps();
+        sz[r] = _mm256_setzero_ps();
+        sp[r] = _mm256_setzero_ps();
+    }
+
+    std::size_t j = 0;
+    for (; j + 8 <= n; j += 8) {
+        const __m256 xj = _mm256_loadu_ps(x + j);
+        const __m256 yj = _mm256_loadu_ps(y + j);
+        const __m256 zj = Dim == 3 ? _mm256_loadu_ps(z + j) : _mm256_setzero_ps();
+        const __m256 mj = _mm256_loadu_ps(mass + j);
+        for (std::size_t r = 0; r < R; ++r) {
+            __m256 dx = _mm256_sub_ps(xj, _mm256_set1_ps(xi[r]));
+            __m256 dy = _mm256_sub_ps(yj, _mm256_set1_ps(yi[r]));
+            __m256 dz = _mm256_setzero_ps();
+            __m256 dist_sq = eps;
+            if constexpr (Dim == 3) {
+                dz = _mm256_sub_ps(zj, _mm256_set1_ps(zi[r]));
+                dist_sq = _mm256_fmadd_ps(dz, dz, dist_sq);
+            }
+            dist_sq = _mm256_fmadd_ps(dx, dx, _mm256_fmadd_ps(dy, dy, dist_sq));
+            __m256 inv_dist = invSqrt(dist_sq);
+            const __m256 other = _mm256_cmp_ps(dist_sq, eps, _CMP_GT_OQ);
+            __m256 s = _mm256_and_ps(other, _mm256_mul_ps(mj, _mm256_mul_ps(inv_dist, _mm256_mul_ps(inv_dist, inv_dist))));
+            sx[r] = _mm256_fmadd_ps(s, dx, sx[r]);
+            sy[r] = _mm256_fmadd_ps(s, dy, sy[r]);
+            if constexpr (Dim == 3) sz[r] = _mm256_fmadd_ps(s, dz, sz[r]);
+            if constexpr (Potential) sp[r] = _mm256_add_ps(sp[r], _mm256_and_ps(other, _mm256_mul_ps(mj, inv_dist)));
+        }
+    }
+
+    for (std::size_t r = 0; r < R; ++r) {
+        ax[r] += horizontalSum(sx[r]);
+        ay[r] += horizontalSum(sy[r]);
+        if constexpr (Dim == 3) az[r] += horizontalSum(sz[r]);
+        if constexpr (Potential) phi[r] += horizontalSum(sp[r]);
+    }
+    accumulateBlockScalar<Dim, Potential>(x, y, z, mass, j, n, xi, yi, zi, softening_sq, ax, ay, az, phi);
+}
+
+#else
+
+template <int Dim, bool Potential, typename Real>
+void accumulateSimd(const Real* x, const Real* y, const Real* z, const Real* mass, std::size_t n,
+                    Real xi, Real yi, Real zi, Real softening_sq, double* ax, double* ay, double* az,
+                    double* phi) {
+    accumulateScalar<Dim, Potential>(x, y, z, mass, 0, n, xi, yi, zi, softening_sq, ax, ay, az, phi);
+}
+
+template <int Dim, bool Potential, typename Real>
+void accumulateBlockSimd(const Real* x, const Real* y, const Real* z, const Real* mass, std::size_t n,
+                         const Real* xi, const Real* yi, const Real* zi, Real softening_sq,
+                         double* ax, double* ay, double* az, double* phi) {
+    accumulateBlockScalar<Dim, Potential>(x, y, z, mass, 0, n, xi, yi, zi, softening_sq, ax, ay, az, phi);
+}
+
+#endif
+
+// Blocks of TARGET_BLOCK targets, then the remaining targets one at a time
+template <int Dim, bool Potential, typename Real>
+void accumulateTargets(const Real* x, const Real* y, const Real* z, const Real* mass, std::size_t n,
+                       const Real* xi, const Real* yi, const Real* zi, std::size_t m, Real softening_sq,
+                       double* ax, double* ay, double* az, double* phi) {
+    // Unused arrays are null, where there is nothing to offset
+    auto at = [](bool used, auto* p, std::size_t r) { return used ? p + r : p; };
+
+    std::size_t r = 0;
+    for (; r + R <= m; r += R) {
+        accumulateBlockSimd<Dim, Potential>(x, y, z, mass, n, xi + r, yi + r, at(Dim == 3, zi, r), softening_sq,
+                                            ax + r, ay + r, at(Dim == 3, az, r), at(Potential, phi, r));
+    }
+    for (; r < m; ++r) {
+        accumulateSimd<Dim, Potential>(x, y, z, mass, n, xi[r], yi[r], Dim == 3 ? zi[r] : Real(0), softening_sq,
+                                       ax + r, ay + r, at(Dim == 3, az, r), at(Potential, phi, r));
+    }
+}
+
+// Pairs are distinct bodies, but two of them can still sit at the same
+// position: like the self pair in the other kernels, such a pair has a squared
+// distance of the softening alone and is masked out of the force and potential
+template <int Dim, bool Potential>
+void accumulatePairsDim(const double* x, const double* y, const double* z, const double* mass,
+                        std::size_t i_begin, std::size_t i_end, std::size_t j_begin, std::size_t j_end,
+                        double softening_sq, double* ax, double* ay, double* az, double* phi) {
+    const bool same_block = i_begin == j_begin;
+
+    for (std::size_t i = i_begin; i < i_end; ++i) {
+        const double xi = x[i];
+        const double yi = y[i];
+        const double zi = Dim == 3 ? z[i] : 0.0;
+        const double mi = mass[i];
+        double sx = 0.0;
+        double sy = 0.0;
+        [[maybe_unused]] double sz = 0.0;
+        [[maybe_unused]] double sp = 0.0;
+
+        // The writes to ax[j], ay[j] never alias within one i, so the loop vectorizes
+        #pragma omp simd reduction(+:sx, sy, sz, sp)
+        for (std::size_t j = same_block ? i + 1 : j_begin; j < j_end; ++j) {
+            double dx = x[j] - xi;
+            double dy = y[j] - yi;
+            double dist_sq = dx*dx + dy*dy + softening_sq;
+            [[maybe_unused]] double dz = 0.0;
+            if constexpr (Dim == 3) {
+                dz = z[j] - zi;
+                dist_sq += dz*dz;
+            }
+            double inv_dist = dist_sq > softening_sq ? 1.0 / std::sqrt(dist_sq) : 0.0;
+            double inv_dist3 = inv_dist * inv_dist * inv_dist;
+            double si = mass[j] * inv_dist3;
+            double sj = mi * inv_dist3;
+            sx += si * dx;
+            sy += si * dy;
+            ax[j] -= sj * dx;
+            ay[j] -= sj * dy;
+            if constexpr (Dim == 3) {
+                sz += si * dz;
+                az[j] -= sj * dz;
+            }
+            if constexpr (Potential) {
+                sp += mass[j] * inv_dist;
+                phi[j] += mi * inv_dist;
+            }
+        }
+
+        ax[i] += sx;
+        ay[i] += sy;
+        if constexpr (Dim == 3) az[i] += sz;
+        if constexpr (Potential) phi[i] += sp;
+    }
+}
+
+// Calls f(Dim, Potential) as integral constants, so one branch per call
+// selects the instantiation
+template <typename F>
+void dispatch(bool three_d, bool potential, F&& f) {
+    using Two = std::integral_constant<int, 2>;
+    using Three = std::integral_constant<int, 3>;
+    if (three_d) {
+        if (potential) f(Three{}, std::true_type{});
+        else f(Three{}, std::false_type{});
+    } else {
+        if (potential) f(Two{}, std::true_type{});
+        else f(Two{}, std::false_type{});
+    }
+}
+
+} // namespace
+
+const char* ForceKernel::name() {
+#if defined(NBODY_KERNEL_AVX512) && defined(NBODY_FAST_RSQRT)
+    return "avx512 (rsqrt+newton)";
+#elif defined(NBODY_KERNEL_AVX512)
+    return "avx512";
+#elif defined(NBODY_KERNEL_AVX2) && defined(NBODY_FAST_RSQRT)
+    return "avx2 (rsqrt+newton)";
+#elif defined(NBODY_KERNEL_AVX2)
+    return "avx2";
+#else
+    return "omp simd";
+#endif
+}
+
+void ForceKernel::accumulate(const double* x, const double* y, const double* mass, std::size_t n,
+                             double xi, double yi, double softening_sq, double& ax, double& ay, double* phi) {
+    dispatch(false, phi != nullptr, [&](auto, auto potential) {
+        accumulateSimd<2, decltype(potential)::value>(x, y, static_cast<const double*>(nullptr), mass, n, xi, yi,
+                                                      0.0, softening_sq, &ax, &ay, static_cast<double*>(nullptr),
+                                                      phi);
+    });
+}
+
+void ForceKernel::accumulateMany(const double* x, const double* y, const double* z, const double* mass,
+                                 std::size_t n, const double* xi, const double* yi, const double* zi, std::size_t m,
+                                 double softening_sq, double* ax, double* ay, double* az, double* phi) {
+    dispatch(z != nullptr, phi != nullptr, [&](auto dim, auto potential) {
+        accumulateTargets<decltype(dim)::value, decltype(potential)::value>(x, y, z, mass, n, xi, yi, zi, m,
+                                                                            softening_sq, ax, ay, az, phi);
+    });
+}
+
+void ForceKernel::accumulateMany(const float* x, const float* y, const float* z, const float* mass,
+                                 std::size_t n, const float* xi, const float* yi, const float* zi, std::size_t m,
+                                 double softening_sq, double* ax, double* ay, double* az, double* phi) {
+    const float eps = static_cast<float>(softening_sq);
+    dispatch(z != nullptr, phi != nullptr, [&](auto dim, auto potential) {
+        accumulateTargets<decltype(dim)::value, decltype(potential)::value>(x, y, z, mass, n, xi, yi, zi, m,
+                                                                            eps, ax, ay, az, phi);
+    });
+}
+
+void ForceKernel::accumulatePairs(const double* x, const double* y, const double* z, const double* mass,
+                                  std::size_t i_begin, std::size_t i_end, std::size_t j_begin, std::size_t j_end,
+                                  double softening_sq, double* ax, double* ay, double* az, double* phi) {
+    dispatch(z != nullptr, phi != nullptr, [&](auto dim, auto potential) {
+        accumulatePairsDim<decltype(dim)::value, decltype(potential)::value>(x, y, z, mass, i_begin, i_end,
+                                                                             j_begin, j_end, softening_sq,
+                                                                             ax, ay, az, phi);
+    });
+}
+
+} // namespace nbody
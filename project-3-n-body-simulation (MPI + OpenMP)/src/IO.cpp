@@ -3,10 +3,32 @@
 #include <fstream>
 #include <stdexcept>
 #include <iomanip>
+#include <algorithm>
+#include <cstring>
+#include <sstream>
+#include <vector>
+#include <mpi.h>
 
 namespace nbody {
 
-std::pair<double, int> IO::readInput(const std::string& filename, SystemState& bodies) {
+static_assert(sizeof(BinaryHeader) == IO::BINARY_HEADER_SIZE, "BinaryHeader must match the on-disk size");
+
+namespace {
+
+constexpr char BINARY_MAGIC[8] = {'N', 'B', 'O', 'D', 'Y', 'B', 'I', 'N'};
+
+void checkMpi(int status, const std::string& what, const std::string& filename) {
+    if (status != MPI_SUCCESS) {
+        char message[MPI_MAX_ERROR_STRING];
+        int length = 0;
+        MPI_Error_string(status, message, &length);
+        throw std::runtime_error(what + " " + filename + ": " + std::string(message, length));
+    }
+}
+
+} // namespace
+
+std::pair<double, int> IO::readInput(const std::string& filename, SystemState& bodies, int& dimensions) {
     std::ifstream file(filename);
     if (!file.is_open()) {
         throw std::runtime_error("Could not open input file: " + filename);
@@ -24,10 +46,28 @@ std::pair<double, int> IO::readInput(const std::string& filename, SystemState& b
     bodies.clear();
     bodies.reserve(n_bodies);
 
-    // Read bodies: mass, pos_x, pos_y, vel_x, vel_y
+    // The column count of the first body line tells 2D from 3D
+    dimensions = 2;
+    std::streampos first_body = file.tellg();
+    std::string line;
+    while (std::getline(file, line) && line.find_first_not_of(" \t\r") == std::string::npos) {}
+    std::istringstream columns(line);
+    int n_columns = 0;
+    for (std::string column; columns >> column;) ++n_columns;
+    if (n_columns == 7) {
+        dimensions = 3;
+    } else if (n_bodies > 0 && n_columns != 5) {
+        throw std::runtime_error("Error reading body 0: expected 5 (2D) or 7 (3D) columns in " + filename);
+    }
+    file.clear();
+    file.seekg(first_body);
+
+    // Read bodies: mass, pos_x, pos_y, [pos_z,] vel_x, vel_y[, vel_z]
     for (int i = 0; i < n_bodies; ++i) {
-        Body b;
-        if (!(file >> b.mass >> b.x >> b.y >> b.vx >> b.vy)) {
+        Body b{};
+        bool ok = dimensions == 3 ? static_cast<bool>(file >> b.mass >> b.x >> b.y >> b.z >> b.vx >> b.vy >> b.vz)
+                                  : static_cast<bool>(file >> b.mass >> b.x >> b.y >> b.vx >> b.vy);
+        if (!ok) {
             throw std::runtime_error("Error reading body " + std::to_string(i));
         }
         bodies.push_back(b);
@@ -35,11 +75,13 @@ std::pair<double, int> IO::readInput(const std::string& filename, SystemState& b
 
     file.close();
 
-    std::cout << "[IO] Loaded " << bodies.size() << " bodies. Steps=" << n_steps << ", dt=" << dt << "\n";
+    std::cout << "[IO] Loaded " << bodies.size() << (dimensions == 3 ? " 3D" : "") << " bodies. Steps=" << n_steps
+              << ", dt=" << dt << "\n";
     return {dt, n_steps};
 }
 
-void IO::writeOutput(const std::string& filename, const SystemState& bodies, double dt, int steps) {
+void IO::writeOutput(const std::string& filename, const SystemState& bodies, double dt, int steps,
+                     int dimensions) {
     std::ofstream file(filename);
     if (!file.is_open()) {
         throw std::runtime_error("Could not open output file: " + filename);
@@ -51,13 +93,164 @@ void IO::writeOutput(const std::string& filename, const SystemState& bodies, dou
     file << std::scientific << std::setprecision(6) << dt << "\n";
 
     for (const auto& b : bodies) {
-        file << b.mass << "\t" 
-             << b.x << "\t" << b.y << "\t" 
-             << b.vx << "\t" << b.vy << "\n";
+        if (dimensions == 3) {
+            file << b.mass << "\t"
+                 << b.x << "\t" << b.y << "\t" << b.z << "\t"
+                 << b.vx << "\t" << b.vy << "\t" << b.vz << "\n";
+        } else {
+            file << b.mass << "\t" 
+                 << b.x << "\t" << b.y << "\t" 
+                 << b.vx << "\t" << b.vy << "\n";
+        }
     }
 
     file.close();
     std::cout << "[IO] Wrote " << bodies.size() << " bodies to " << filename << "\n";
 }
 
+BinaryHeader IO::makeBinaryHeader(std::size_t total_bodies, int dimensions, double dt, int steps,
+                                  std::uint64_t step, std::uint32_t extra_fields) {
+    BinaryHeader header{};
+    std::memcpy(header.magic, BINARY_MAGIC, sizeof(BINARY_MAGIC));
+    header.version = BINARY_VERSION;
+    header.fields = stateFields(dimensions) + extra_fields;
+    header.dimensions = dimensions;
+    header.count = total_bodies;
+    header.steps = steps;
+    header.dt = dt;
+    header.step = step;
+    return header;
+}
+
+void IO::packRecords(const SystemState& bodies, int dimensions, std::vector<double>& records,
+                     const std::vector<double>* extra, std::uint32_t extra_fields) {
+    const std::size_t state = stateFields(dimensions);
+    const std::size_t fields = state + (extra ? extra_fields : 0);
+    records.resize(bodies.size() * fields);
+    for (std::size_t i = 0; i < bodies.size(); ++i) {
+        double* r = &records[i * fields];
+        r[0] = bodies[i].mass;
+        r[1] = bodies[i].x;
+        r[2] = bodies[i].y;
+        if (dimensions == 3) {
+            r[3] = bodies[i].z;
+            r[4] = bodies[i].vx;
+            r[5] = bodies[i].vy;
+            r[6] = bodies[i].vz;
+        } else {
+            r[3] = bodies[i].vx;
+            r[4] = bodies[i].vy;
+        }
+        for (std::size_t f = state; f < fields; ++f) {
+            r[f] = (*extra)[i * extra_fields + (f - state)];
+        }
+    }
+}
+
+bool IO::isBinary(const std::string& filename) {
+    std::ifstream file(filename, std::ios::binary);
+    char magic[sizeof(BINARY_MAGIC)] = {};
+    return file.read(magic, sizeof(magic)) && std::memcmp(magic, BINARY_MAGIC, sizeof(magic)) == 0;
+}
+
+BinaryHeader IO::readBinary(const std::string& filename, const DomainDecomposition& domain,
+                            SystemState& local_bodies, std::vector<double>* extra) {
+    MPI_File file;
+    checkMpi(MPI_File_open(MPI_COMM_WORLD, filename.c_str(), MPI_MODE_RDONLY, MPI_INFO_NULL, &file),
+             "Could not open binary input", filename);
+
+    // MPI-IO errors default to MPI_ERRORS_RETURN, so each call is checked
+    BinaryHeader header{};
+    checkMpi(MPI_File_read_at_all(file, 0, &header, sizeof(header), MPI_BYTE, MPI_STATUS_IGNORE),
+             "Error reading header from", filename);
+
+    if (header.dimensions == 0) header.dimensions = 2;
+    if (std::memcmp(header.magic, BINARY_MAGIC, sizeof(BINARY_MAGIC)) != 0 || header.version != BINARY_VERSION ||
+        (header.dimensions != 2 && header.dimensions != 3) || header.fields < stateFields(header.dimensions)) {
+        MPI_File_close(&file);
+        throw std::runtime_error("Not a supported binary state file: " + filename);
+    }
+
+    MPI_Offset file_size = 0;
+    MPI_File_get_size(file, &file_size);
+    MPI_Offset expected = static_cast<MPI_Offset>(BINARY_HEADER_SIZE + header.count * header.fields * sizeof(double));
+    if (file_size < expected) {
+        MPI_File_close(&file);
+        throw std::runtime_error("Truncated binary state file: " + filename);
+    }
+
+    std::size_t start = domain.getLocalStart(header.count);
+    std::size_t count = domain.getLocalCount(header.count);
+    std::vector<double> records(count * header.fields);
+
+    MPI_Offset offset = static_cast<MPI_Offset>(BINARY_HEADER_SIZE + start * header.fields * sizeof(double));
+    int status = MPI_File_read_at_all(file, offset, records.data(), static_cast<int>(records.size()), MPI_DOUBLE,
+                                      MPI_STATUS_IGNORE);
+    MPI_File_close(&file);
+    checkMpi(status, "Error reading bodies from", filename);
+
+    const bool three_d = header.dimensions == 3;
+    const std::size_t state = stateFields(header.dimensions);
+    const std::size_t extra_fields = header.fields - state;
+    local_bodies.assign(count, Body{});
+    if (extra) extra->resize(count * extra_fields);
+
+    for (std::size_t i = 0; i < count; ++i) {
+        const double* r = &records[i * header.fields];
+        local_bodies[i].mass = r[0];
+        local_bodies[i].x = r[1];
+        local_bodies[i].y = r[2];
+        if (three_d) {
+            local_bodies[i].z = r[3];
+            local_bodies[i].vx = r[4];
+            local_bodies[i].vy = r[5];
+            local_bodies[i].vz = r[6];
+        } else {
+            local_bodies[i].vx = r[3];
+            local_bodies[i].vy = r[4];
+        }
+        if (extra) {
+            std::copy(r + state, r + header.fields, extra->begin() + i * extra_fields);
+        }
+    }
+
+    if (domain.getRank() == 0) {
+        std::cout << "[IO] Loaded " << header.count << (three_d ? " 3D" : "") << " bodies (binary, MPI-IO). Steps="
+                  << header.steps
+                  << ", dt=" << header.dt << "\n";
+    }
+    return header;
+}
+
+void IO::writeBinary(const std::string& filename, const DomainDecomposition& domain,
+                     const SystemState& local_bodies, std::size_t total_bodies, int dimensions,
+                     double dt, int steps, std::uint64_t step,
+                     const std::vector<double>* extra, std::uint32_t extra_fields) {
+    MPI_File file;
+    checkMpi(MPI_File_open(MPI_COMM_WORLD, filename.c_str(), MPI_MODE_WRONLY | MPI_MODE_CREATE, MPI_INFO_NULL, &file),
+             "Could not open binary output", filename);
+    MPI_File_set_size(file, 0);
+
+    if (!extra) extra_fields = 0;
+    const std::size_t fields = stateFields(dimensions) + extra_fields;
+    BinaryHeader header = makeBinaryHeader(total_bodies, dimensions, dt, steps, step, extra_fields);
+    std::vector<double> records;
+    packRecords(local_bodies, dimensions, records, extra, extra_fields);
+
+    int header_bytes = domain.getRank() == 0 ? static_cast<int>(sizeof(header)) : 0;
+    int status = MPI_File_write_at_all(file, 0, &header, header_bytes, MPI_BYTE, MPI_STATUS_IGNORE);
+
+    std::size_t start = domain.getLocalStart(total_bodies);
+    MPI_Offset offset = static_cast<MPI_Offset>(BINARY_HEADER_SIZE + start * fields * sizeof(double));
+    int records_status = MPI_File_write_at_all(file, offset, records.data(), static_cast<int>(records.size()),
+                                               MPI_DOUBLE, MPI_STATUS_IGNORE);
+    if (status == MPI_SUCCESS) status = records_status;
+    MPI_File_close(&file);
+    checkMpi(status, "Error writing", filename);
+
+    if (domain.getRank() == 0) {
+        std::cout << "[IO] Wrote " << total_bodies << " bodies to " << filename << " (binary, MPI-IO)\n";
+    }
+}
+
 } // namespace nbody
\ No newline at end of file
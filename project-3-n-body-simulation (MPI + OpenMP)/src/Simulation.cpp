@@ -1,22 +1,76 @@
 #include "nbody/Simulation.hpp"
-#include "nbody/Constants.hpp"
+#include "nbody/ForceKernel.hpp"
+#include "nbody/IO.hpp"
+#include "nbody/SpaceFillingCurve.hpp"
 #include <iostream>
 #include <cmath>
 #include <mpi.h>
 #include <omp.h>
 #include <iomanip>
+#include <sstream>
+#include <cstdio>
+#include <stdexcept>
+#include <algorithm>
+#include <iterator>
+#include <numeric>
+#include <type_traits>
 
 namespace nbody {
 
-Simulation::Simulation(const DomainDecomposition& domain) 
-    : domain_(domain) {}
+namespace {
 
-void Simulation::init(const SystemState& global_initial_bodies) {
+// Bodies per block in the symmetric solver; a pair of blocks fits in L1
+constexpr int SYMMETRIC_BLOCK_SIZE = 256;
+
+// Direct solver tile candidates: target tiles, and source slices from 12 KB
+// (L1) to 192 KB (L2) of x, y and mass
+constexpr int I_TILE_CANDIDATES[] = {32, 128, 512};
+constexpr int J_TILE_CANDIDATES[] = {512, 2048, 8192};
+constexpr int MAX_I_TILE = 512;
+
+// Repartition only when the slowest rank's force time exceeds the mean by this
+// factor, so timing noise does not shuffle bodies back and forth
+constexpr double REBALANCE_THRESHOLD = 1.05;
+
+// Buckets of the top key bits in the global histogram of sortBodies
+constexpr int SORT_HISTOGRAM_BITS = 16;
+
+// Per-body state that moves with a body: level, last acceleration (x, y, z),
+// force (x, y, z), cost
+constexpr int MIGRATED_FIELDS = 8;
+
+// Yoshida (1990) 4th-order composition: substeps of w1, w0, w1 times dt
+const double YOSHIDA_CBRT2 = std::cbrt(2.0);
+const double YOSHIDA_W1 = 1.0 / (2.0 - YOSHIDA_CBRT2);
+const double YOSHIDA_W0 = -YOSHIDA_CBRT2 / (2.0 - YOSHIDA_CBRT2);
+
+const char* integratorName(Integrator integrator) {
+    switch (integrator) {
+        case Integrator::Leapfrog: return "leapfrog (velocity-Verlet KDK)";
+        case Integrator::Yoshida4: return "yoshida4";
+        default: return "symplectic euler";
+    }
+}
+
+} // namespace
+
+Simulation::Simulation(const DomainDecomposition& domain, const SimulationOptions& options)
+    : domain_(domain), options_(options), softening_sq_(options.softening * options.softening) {
+    if (options_.solver == Solver::BarnesHut) {
+        tree_ = std::make_unique<BarnesHutTree>(options_.theta, options_.softening);
+    }
+    if (options_.snapshot_every > 0) {
+        snapshots_ = std::make_unique<SnapshotWriter>(domain_, options_.snapshot_prefix);
+    }
+}
+
+void Simulation::init(const SystemState& global_initial_bodies, int dimensions) {
     int total_bodies = 0;
     if (domain_.getRank() == 0) {
         total_bodies = static_cast<int>(global_initial_bodies.size());
     }
     MPI_Bcast(&total_bodies, 1, MPI_INT, 0, MPI_COMM_WORLD);
+    MPI_Bcast(&dimensions, 1, MPI_INT, 0, MPI_COMM_WORLD);
 
     auto [counts, displs] = domain_.getcv(total_bodies);
     int my_count = counts[domain_.getRank()];
@@ -32,18 +86,225 @@ void Simulation::init(const SystemState& global_initial_bodies) {
         0, MPI_COMM_WORLD
     );
 
-    // Prepare global buffer
-    global_bodies_snapshot_.resize(total_bodies);
+    initLocal(local_bodies_, total_bodies, dimensions);
+}
+
+void Simulation::initLocal(const SystemState& local_bodies, int total_bodies, int dimensions) {
+    if (&local_bodies != &local_bodies_) {
+        local_bodies_ = local_bodies;
+    }
+    int my_count = static_cast<int>(local_bodies_.size());
+    dimensions_ = dimensions;
+
+    // Prepare global buffers
+    global_bodies_snapshot_.resize(total_bodies, dimensions_);
+    resizeLocalState(total_bodies);
+    forces_current_ = false;
+
+    levels_.assign(my_count, -1);
+    last_acc_x_.assign(my_count, 0.0);
+    last_acc_y_.assign(my_count, 0.0);
+    last_acc_z_.assign(my_count, 0.0);
+    costs_.assign(my_count, 0.0);
+
+    ids_.resize(my_count);
+    std::iota(ids_.begin(), ids_.end(), static_cast<std::uint64_t>(domain_.getLocalStart(total_bodies)));
+    curve_ordered_ = false;
+}
+
+// Buffers whose size follows this rank's share of the bodies
+void Simulation::resizeLocalState(int total_bodies) {
+    auto [counts, displs] = domain_.getcv(total_bodies);
+    int my_count = static_cast<int>(local_bodies_.size());
+
+    local_positions_.resize(my_count, dimensions_);
+    forces_x_.resize(my_count);
+    forces_y_.resize(my_count);
+    forces_z_.resize(my_count);
+
+    // Positions and mass per ring slot
+    const std::size_t fields = static_cast<std::size_t>(dimensions_) + 1;
+    ring_stride_ = counts.empty() ? 0 : *std::max_element(counts.begin(), counts.end());
+    ring_current_.resize(fields * static_cast<std::size_t>(ring_stride_));
+    ring_next_.resize(fields * static_cast<std::size_t>(ring_stride_));
+    if (options_.precision == Precision::Mixed) {
+        ring_float_.resize(fields * static_cast<std::size_t>(ring_stride_));
+    }
+}
+
+void Simulation::restore(const std::vector<double>& extra, std::uint64_t step) {
+    const std::size_t n_local = local_bodies_.size();
+    const std::size_t fields = checkpointFields(dimensions_);
+    if (extra.size() == n_local * fields) {
+        for (std::size_t i = 0; i < n_local; ++i) {
+            levels_[i] = static_cast<int>(extra[i * fields]);
+            last_acc_x_[i] = extra[i * fields + 1];
+            last_acc_y_[i] = extra[i * fields + 2];
+            if (dimensions_ == 3) last_acc_z_[i] = extra[i * fields + 3];
+        }
+    }
+    start_step_ = step;
+    forces_current_ = false;
+}
+
+// Written next to the target and renamed once every rank has closed the
+// file, so a run killed mid-write still finds the previous checkpoint
+void Simulation::writeCheckpoint(std::uint64_t step, int steps, double dt) {
+    const std::size_t n_local = local_bodies_.size();
+    const std::uint32_t fields = checkpointFields(dimensions_);
+    std::vector<double> extra(n_local * fields);
+    for (std::size_t i = 0; i < n_local; ++i) {
+        extra[i * fields] = levels_[i];
+        extra[i * fields + 1] = last_acc_x_[i];
+        extra[i * fields + 2] = last_acc_y_[i];
+        if (dimensions_ == 3) extra[i * fields + 3] = last_acc_z_[i];
+    }
+
+    const std::string partial = options_.checkpoint_path + ".partial";
+    IO::writeBinary(partial, domain_, local_bodies_, global_bodies_snapshot_.size(), dimensions_, dt, steps, step,
+                    &extra, fields);
+
+    if (domain_.getRank() == 0 && std::rename(partial.c_str(), options_.checkpoint_path.c_str()) != 0) {
+        throw std::runtime_error("Could not move checkpoint into place: " + options_.checkpoint_path);
+    }
+}
+
+// Rank 0 writes the time series. A restarted run appends to the series of
+// the run it continues when there is one; returns whether it does.
+bool Simulation::openDiagnostics() {
+    diagnostics_samples_ = 0;
+    energy_drift_ = 0.0;
+    momentum_drift_ = 0.0;
+    angular_momentum_drift_ = 0.0;
+    if (domain_.getRank() != 0) return true;
+
+    // A restart keeps the series up to its step (later rows were written after
+    // the checkpoint and are sampled again) and still measures from its first row
+    std::vector<std::string> kept;
+    bool has_start = false;
+    if (start_step_ > 0) {
+        std::ifstream existing(options_.diagnostics_path);
+        std::string line;
+        while (std::getline(existing, line)) {
+            if (line.empty()) continue;
+            if (line[0] == '#') {
+                kept.push_back(line);
+                continue;
+            }
+            std::istringstream row(line);
+            std::uint64_t step = 0;
+            double time = 0.0, wall = 0.0, total = 0.0;
+            Diagnostics d;
+            row >> step >> time >> wall >> d.kinetic >> d.potential >> total >> d.momentum[0] >> d.momentum[1];
+            if (dimensions_ == 3) {
+                row >> d.momentum[2] >> d.angular_momentum[0] >> d.angular_momentum[1];
+            }
+            row >> d.angular_momentum[2];
+            if (!row) {
+                throw std::runtime_error("Malformed diagnostics row in " + options_.diagnostics_path + ": " + line);
+            }
+            if (step > start_step_) break;
+            kept.push_back(line);
+            has_start = step == start_step_;
+            noteDiagnostics(d);
+        }
+    }
+    diagnostics_file_.open(options_.diagnostics_path, std::ios::trunc);
+    if (!diagnostics_file_) {
+        throw std::runtime_error("Could not open diagnostics file: " + options_.diagnostics_path);
+    }
+    if (kept.empty()) {
+        diagnostics_file_ << "# step time wall_s kinetic potential total "
+                          << (dimensions_ == 3 ? "px py pz Lx Ly Lz" : "px py Lz") << "\n";
+    }
+    for (const std::string& line : kept) diagnostics_file_ << line << "\n";
+
+    // The first step is written when it is the reference or a sampling step
+    // the kept series lacks
+    return diagnostics_samples_ == 0 || (start_step_ % options_.diagnostics_every == 0 && !has_start);
+}
+
+void Simulation::noteDiagnostics(const Diagnostics& d) {
+    if (diagnostics_samples_ == 0) {
+        first_diagnostics_ = d;
+    } else {
+        const Diagnostics& first = first_diagnostics_;
+        double e0 = std::abs(first.total());
+        energy_drift_ = std::max(energy_drift_, std::abs(d.total() - first.total()) / (e0 > 0.0 ? e0 : 1.0));
+        momentum_drift_ = std::max(momentum_drift_, std::hypot(d.momentum[0] - first.momentum[0],
+                                                               d.momentum[1] - first.momentum[1],
+                                                               d.momentum[2] - first.momentum[2]));
+        angular_momentum_drift_ = std::max(angular_momentum_drift_,
+                                           std::hypot(d.angular_momentum[0] - first.angular_momentum[0],
+                                                      d.angular_momentum[1] - first.angular_momentum[1],
+                                                      d.angular_momentum[2] - first.angular_momentum[2]));
+    }
+    ++diagnostics_samples_;
+}
+
+// Energies and momenta at the end of `step`. The potential comes from the
+// force pass at these positions when the integrator made one (potential_due_);
+// otherwise this makes that pass, and the next step reuses its forces.
+// Collective; every rank gets the totals from one MPI_Allreduce.
+void Simulation::recordDiagnostics(std::uint64_t step, double dt, double wall_seconds, bool write) {
+    if (!forces_current_ || !potential_current_) {
+        potential_due_ = true;
+        computeForces();
+        forces_current_ = true;
+    }
+    potential_due_ = false;
+
+    const int n_local = static_cast<int>(local_bodies_.size());
+    double kinetic = 0.0;
+    double px = 0.0, py = 0.0, pz = 0.0;
+    double lx = 0.0, ly = 0.0, lz = 0.0;
+
+    #pragma omp parallel for schedule(static) reduction(+:kinetic, px, py, pz, lx, ly, lz)
+    for (int i = 0; i < n_local; ++i) {
+        const Body& b = local_bodies_[i];
+        kinetic += 0.5 * b.mass * (b.vx * b.vx + b.vy * b.vy + b.vz * b.vz);
+        px += b.mass * b.vx;
+        py += b.mass * b.vy;
+        pz += b.mass * b.vz;
+        lx += b.mass * (b.y * b.vz - b.z * b.vy);
+        ly += b.mass * (b.z * b.vx - b.x * b.vz);
+        lz += b.mass * (b.x * b.vy - b.y * b.vx);
+    }
+
+    double sums[8] = {kinetic, potential_energy_, px, py, pz, lx, ly, lz};
+    MPI_Allreduce(MPI_IN_PLACE, sums, 8, MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
+
+    Diagnostics d;
+    d.kinetic = sums[0];
+    d.potential = sums[1];
+    std::copy(sums + 2, sums + 5, d.momentum);
+    std::copy(sums + 5, sums + 8, d.angular_momentum);
+
+    if (!write) return;
+    noteDiagnostics(d);
+
+    if (domain_.getRank() != 0) return;
+    diagnostics_file_ << step << " " << std::defaultfloat << std::setprecision(10) << static_cast<double>(step) * dt
+                      << " " << std::fixed << std::setprecision(4) << wall_seconds << std::scientific
+                      << std::setprecision(15) << " " << d.kinetic << " " << d.potential << " " << d.total();
+    if (dimensions_ == 3) {
+        diagnostics_file_ << " " << d.momentum[0] << " " << d.momentum[1] << " " << d.momentum[2] << " "
+                          << d.angular_momentum[0] << " " << d.angular_momentum[1] << " " << d.angular_momentum[2];
+    } else {
+        diagnostics_file_ << " " << d.momentum[0] << " " << d.momentum[1] << " " << d.angular_momentum[2];
+    }
+    diagnostics_file_ << std::endl;
 }
 
 void Simulation::run(int steps, double dt) {
     int rank = domain_.getRank();
     int size = domain_.getSize();
     int total_bodies = static_cast<int>(global_bodies_snapshot_.size());
-    
-    auto [counts, displs] = domain_.getcv(total_bodies);
-    MPI_Datatype body_type = Body::mpiType();
 
+    if (options_.solver == Solver::Direct) {
+        tuneTiles();
+    }
+    
     // ---------------------------------------------------------
     // Performance Header
     // ---------------------------------------------------------
@@ -51,10 +312,43 @@ void Simulation::run(int steps, double dt) {
         std::cout << "========================================\n";
         std::cout << " Hybrid N-Body Simulation \n";
         std::cout << "========================================\n";
-        std::cout << " Bodies     : " << total_bodies << "\n";
-        std::cout << " Steps      : " << steps << "\n";
+        std::cout << " Bodies     : " << total_bodies << (dimensions_ == 3 ? " (3D)" : "") << "\n";
+        std::cout << " Steps      : " << steps;
+        if (start_step_ > 0) std::cout << " (resuming after step " << start_step_ << ")";
+        std::cout << "\n";
         std::cout << " dt         : " << dt << "\n";
         std::cout << " MPI Ranks  : " << size << "\n";
+        std::cout << " Kernel     : " << ForceKernel::name() << "\n";
+        if (options_.solver == Solver::BarnesHut) {
+            std::cout << " Solver     : barnes-hut (theta=" << options_.theta << ")\n";
+        } else if (options_.solver == Solver::Symmetric) {
+            std::cout << " Solver     : direct, symmetric pairs\n";
+        } else {
+            std::cout << " Solver     : direct\n";
+        }
+        std::cout << " Integrator : " << integratorName(options_.integrator) << "\n";
+        std::cout << " Gravity    : G=" << options_.gravity << ", softening=" << options_.softening << "\n";
+        if (options_.precision == Precision::Mixed) {
+            std::cout << " Precision  : mixed (float pair terms, double accumulation)\n";
+        }
+        if (options_.solver == Solver::Direct) {
+            std::cout << " Tiles      : " << i_tile_ << " targets x " << j_tile_ << " bodies (auto-tuned)\n";
+        }
+        if (options_.rebalance_every > 0) {
+            std::cout << " Balance    : by measured cost, every " << options_.rebalance_every << " steps\n";
+        }
+        if (options_.ordering != Ordering::Input) {
+            std::cout << " Ordering   : " << (options_.ordering == Ordering::Hilbert ? "hilbert" : "morton")
+                      << " curve, re-sorted every " << options_.reorder_every << " steps\n";
+        }
+        if (options_.block_levels > 0) {
+            std::cout << " Timesteps  : block, dt / 2^0 .. dt / 2^" << options_.block_levels
+                      << " (eta=" << options_.eta << ")\n";
+        }
+        if (options_.diagnostics_every > 0) {
+            std::cout << " Diagnostics: energy and momenta every " << options_.diagnostics_every << " steps to "
+                      << options_.diagnostics_path << "\n";
+        }
         #pragma omp parallel
         {
             #pragma omp single
@@ -63,27 +357,77 @@ void Simulation::run(int steps, double dt) {
         std::cout << "----------------------------------------\n";
     }
 
+    // Accuracy check on the initial state, outside the timed region
+    if (options_.compare_direct && (options_.solver != Solver::Direct || options_.precision != Precision::Double)) {
+        reportForceError();
+        forces_current_ = false;
+    }
+    interactions_ = 0;
+    body_updates_ = 0;
+    std::fill(costs_.begin(), costs_.end(), 0.0);
+    window_seconds_ = 0.0;
+    force_seconds_ = 0.0;
+    sorts_ = 0;
+    sort_seconds_ = 0.0;
+
     // Barrier to ensure all ranks start timing together
     MPI_Barrier(MPI_COMM_WORLD);
     double start_time = MPI_Wtime();
 
+    if (snapshots_ && start_step_ == 0) {
+        snapshots_->submit(local_bodies_, domain_.getLocalStart(total_bodies), total_bodies, dimensions_, dt, steps, 0);
+    }
+    const int diagnostics_every = options_.diagnostics_every;
+    if (diagnostics_every > 0) {
+        const bool write_start = openDiagnostics();
+        recordDiagnostics(start_step_, dt, 0.0, write_start);
+    }
+    if (options_.ordering != Ordering::Input && static_cast<int>(start_step_) < steps) {
+        reorderByCurve();
+    }
+
     // ---------------------------------------------------------
     // Main Loop
     // ---------------------------------------------------------
-    for (int step = 0; step < steps; ++step) {
+    for (int step = static_cast<int>(start_step_); step < steps; ++step) {
+        const bool last = step + 1 == steps;
+        const bool diagnostics_due = diagnostics_every > 0 && ((step + 1) % diagnostics_every == 0 || last);
+
+        // Integrators that end the step with a force pass sum the potential in it
+        potential_due_ = diagnostics_due && (options_.integrator != Integrator::Euler || options_.block_levels > 0);
         
-        // 1. Communication (All-to-All)
-        MPI_Allgatherv(
-            local_bodies_.data(), static_cast<int>(local_bodies_.size()), body_type,
-            global_bodies_snapshot_.data(), counts.data(), displs.data(), body_type,
-            MPI_COMM_WORLD
-        );
-
-        // 2. Compute Forces (Compute Bound)
-        computeForces();
+        // Force passes (compute bound, exchanging positions on the way)
+        // interleaved with kicks and drifts (memory bound)
+        advance(dt);
 
-        // 3. Integrate (Memory Bound)
-        updatePositions(dt);
+        if (diagnostics_due) {
+            recordDiagnostics(static_cast<std::uint64_t>(step + 1), dt, MPI_Wtime() - start_time);
+        }
+
+        // Files are written in input order, so a curve-ordered run sorts back first
+        const bool snapshot_due = snapshots_ && (step + 1) % options_.snapshot_every == 0;
+        const bool checkpoint_due = options_.checkpoint_every > 0 && (step + 1) % options_.checkpoint_every == 0;
+        if ((snapshot_due || checkpoint_due || last) && curve_ordered_) {
+            restoreInputOrder();
+        }
+
+        // Snapshots only cost a copy here, the writer thread does the I/O
+        if (snapshot_due) {
+            snapshots_->submit(local_bodies_, domain_.getLocalStart(total_bodies), total_bodies, dimensions_, dt,
+                               steps, static_cast<std::uint64_t>(step + 1));
+        }
+        if (checkpoint_due) {
+            writeCheckpoint(static_cast<std::uint64_t>(step + 1), steps, dt);
+        }
+
+        // Sorting resets the even split, so it goes before the rebalance
+        if (options_.ordering != Ordering::Input && !last &&
+            (!curve_ordered_ || (step + 1) % options_.reorder_every == 0)) {
+            reorderByCurve();
+        }
+        if (options_.rebalance_every > 0 && (step + 1) % options_.rebalance_every == 0 && !last) {
+            rebalance();
+        }
         
         // Progress bar (only root)
         if (rank == 0 && (step % 10 == 0 || step == steps - 1)) {
@@ -94,11 +438,36 @@ void Simulation::run(int steps, double dt) {
         }
     }
 
+    // Snapshots still in flight are part of the run
+    if (snapshots_) {
+        snapshots_->finish();
+    }
+    if (diagnostics_file_.is_open()) {
+        diagnostics_file_.close();
+    }
+
     // Barrier to ensure timing correctness
     MPI_Barrier(MPI_COMM_WORLD);
     double end_time = MPI_Wtime();
     double elapsed = end_time - start_time;
 
+    std::uint64_t total_interactions = 0;
+    MPI_Reduce(&interactions_, &total_interactions, 1, MPI_UINT64_T, MPI_SUM, 0, MPI_COMM_WORLD);
+    std::uint64_t total_updates = 0;
+    MPI_Reduce(&body_updates_, &total_updates, 1, MPI_UINT64_T, MPI_SUM, 0, MPI_COMM_WORLD);
+
+    force_seconds_ += window_seconds_;
+    window_seconds_ = 0.0;
+    std::uint64_t max_interactions = 0;
+    MPI_Reduce(&interactions_, &max_interactions, 1, MPI_UINT64_T, MPI_MAX, 0, MPI_COMM_WORLD);
+    double max_force_seconds = 0.0;
+    double sum_force_seconds = 0.0;
+    MPI_Reduce(&force_seconds_, &max_force_seconds, 1, MPI_DOUBLE, MPI_MAX, 0, MPI_COMM_WORLD);
+    MPI_Reduce(&force_seconds_, &sum_force_seconds, 1, MPI_DOUBLE, MPI_SUM, 0, MPI_COMM_WORLD);
+    int count_range[2] = {static_cast<int>(local_bodies_.size()), -static_cast<int>(local_bodies_.size())};
+    int global_range[2] = {0, 0};
+    MPI_Reduce(count_range, global_range, 2, MPI_INT, MPI_MIN, 0, MPI_COMM_WORLD);
+
     // ---------------------------------------------------------
     // Performance Reporting
     // ---------------------------------------------------------
@@ -107,71 +476,935 @@ void Simulation::run(int steps, double dt) {
         std::cout << " Simulation Complete.\n";
         std::cout << " Wall Time  : " << std::fixed << std::setprecision(4) << elapsed << " s\n";
         
-        // Compute stats
-        double interactions_per_step = (double)total_bodies * total_bodies;
-        double total_interactions = interactions_per_step * steps;
-        double interactions_per_sec = total_interactions / elapsed;
+        // Compute stats (N^2 per step for the direct solver, fewer for the tree)
+        double interactions_per_sec = (double)total_interactions / elapsed;
         
         std::cout << " Performance: " << std::scientific << std::setprecision(2) 
                   << interactions_per_sec << " interactions/s\n";
+        if (snapshots_) {
+            std::cout << " Snapshots  : " << snapshots_->written() << " written to " << options_.snapshot_prefix
+                      << "_*.nbody, step loop waited " << std::fixed << std::setprecision(4)
+                      << snapshots_->stallSeconds() << " s\n";
+        }
+        if (options_.block_levels > 0) {
+            // Against every body stepping at the finest level
+            double shared = static_cast<double>(total_bodies) * steps * static_cast<double>(1 << options_.block_levels);
+            std::cout << " Block steps: " << total_updates << " body updates ("
+                      << std::fixed << std::setprecision(1) << 100.0 * total_updates / std::max(shared, 1.0)
+                      << "% of a shared dt / 2^" << options_.block_levels << ")\n";
+        }
+
+        // Time in the force loops only, so waiting on other ranks does not count as load
+        double mean_force_seconds = sum_force_seconds / size;
+        double mean_interactions = static_cast<double>(total_interactions) / size;
+        std::cout << " Imbalance  : " << std::fixed << std::setprecision(2)
+                  << (mean_force_seconds > 0.0 ? max_force_seconds / mean_force_seconds : 1.0) << " force time, "
+                  << (mean_interactions > 0.0 ? max_interactions / mean_interactions : 1.0)
+                  << " interactions (max / mean per rank)";
+        if (rebalances_ > 0) {
+            std::cout << ", " << first_imbalance_ << " before the first rebalance";
+        }
+        std::cout << "\n";
+        if (options_.ordering != Ordering::Input) {
+            std::cout << " Ordering   : " << sorts_ << " parallel sorts, " << std::fixed << std::setprecision(4)
+                      << sort_seconds_ << " s\n";
+        }
+        if (diagnostics_every > 0) {
+            std::cout << " Diagnostics: " << diagnostics_samples_ << " samples in " << options_.diagnostics_path
+                      << ", max |dE/E0| " << std::scientific << std::setprecision(2) << energy_drift_
+                      << ", max |dP| " << momentum_drift_ << ", max |dL| " << angular_momentum_drift_ << "\n";
+        }
+        if (options_.rebalance_every > 0) {
+            std::cout << " Rebalance  : " << rebalances_ << " repartitions, " << migrated_ << " bodies migrated, "
+                      << global_range[0] << " .. " << -global_range[1] << " bodies per rank\n";
+        }
         std::cout << "========================================\n";
     }
 }
 
-void Simulation::computeForces() {
+void Simulation::packLocalPositions() {
     int n_local = static_cast<int>(local_bodies_.size());
-    int n_global = static_cast<int>(global_bodies_snapshot_.size());
-    
+    const bool three_d = dimensions_ == 3;
+
+    // Only positions and masses are needed, one array each
+    #pragma omp parallel for schedule(static)
+    for (int i = 0; i < n_local; ++i) {
+        local_positions_.x[i] = local_bodies_[i].x;
+        local_positions_.y[i] = local_bodies_[i].y;
+        if (three_d) local_positions_.z[i] = local_bodies_[i].z;
+        local_positions_.mass[i] = local_bodies_[i].mass;
+    }
+}
+
+void Simulation::exchangePositions() {
+    int total_bodies = static_cast<int>(global_bodies_snapshot_.size());
+    int n_local = static_cast<int>(local_bodies_.size());
+    auto [counts, displs] = domain_.getcv(total_bodies);
+
+    packLocalPositions();
+
+    MPI_Allgatherv(local_positions_.x.data(), n_local, MPI_DOUBLE,
+                   global_bodies_snapshot_.x.data(), counts.data(), displs.data(), MPI_DOUBLE, MPI_COMM_WORLD);
+    MPI_Allgatherv(local_positions_.y.data(), n_local, MPI_DOUBLE,
+                   global_bodies_snapshot_.y.data(), counts.data(), displs.data(), MPI_DOUBLE, MPI_COMM_WORLD);
+    if (dimensions_ == 3) {
+        MPI_Allgatherv(local_positions_.z.data(), n_local, MPI_DOUBLE,
+                       global_bodies_snapshot_.z.data(), counts.data(), displs.data(), MPI_DOUBLE, MPI_COMM_WORLD);
+    }
+    MPI_Allgatherv(local_positions_.mass.data(), n_local, MPI_DOUBLE,
+                   global_bodies_snapshot_.mass.data(), counts.data(), displs.data(), MPI_DOUBLE, MPI_COMM_WORLD);
+}
+
+void Simulation::computeForces(const std::vector<int>* active) {
     // Resize forces vectors if needed (safety check)
     if (forces_x_.size() != local_bodies_.size()) {
-        forces_x_.resize(n_local);
-        forces_y_.resize(n_local);
+        forces_x_.resize(local_bodies_.size());
+        forces_y_.resize(local_bodies_.size());
+        forces_z_.resize(local_bodies_.size());
     }
-    
-    // Pre-calculate global offset for this rank
-    size_t my_offset = domain_.getLocalStart(n_global);
+
+    // The potential energy needs every local body as a target
+    const bool potential = potential_due_ && (!active || active->size() == local_bodies_.size());
+
+    if (options_.solver == Solver::BarnesHut) {
+        exchangePositions();
+        computeTreeForces(active, potential);
+    } else if (options_.solver == Solver::Symmetric) {
+        // Never given an active list: main rejects it with block timesteps
+        exchangePositions();
+        computeSymmetricForces(potential);
+    } else {
+        computeDirectForces(active, options_.precision, potential);
+    }
+    if (potential) potential_current_ = true;
+}
+
+// Systolic ring: every rank starts with its own block of (x, y, [z,] mass) and
+// passes the block it holds to the right neighbour while it computes against
+// it, so after `size` rounds every local body has seen every block and the
+// transfer of the next block overlaps the computation of the current one
+void Simulation::computeDirectForces(const std::vector<int>* active, Precision precision, bool potential) {
+    int n_local = static_cast<int>(local_bodies_.size());
+    int n_active = active ? static_cast<int>(active->size()) : n_local;
+    int n_global = static_cast<int>(global_bodies_snapshot_.size());
+    int rank = domain_.getRank();
+    int size = domain_.getSize();
+    auto [counts, displs] = domain_.getcv(n_global);
+
+    const int right = (rank + 1) % size;
+    const int left = (rank + size - 1) % size;
+    const std::size_t stride = static_cast<std::size_t>(ring_stride_);
+    const bool three_d = dimensions_ == 3;
+    const std::size_t mass_offset = static_cast<std::size_t>(dimensions_) * stride;
+    const int block_size = static_cast<int>(mass_offset + stride);
+
+    packLocalPositions();
+    std::copy(local_positions_.x.begin(), local_positions_.x.end(), ring_current_.begin());
+    std::copy(local_positions_.y.begin(), local_positions_.y.end(), ring_current_.begin() + stride);
+    if (three_d) std::copy(local_positions_.z.begin(), local_positions_.z.end(), ring_current_.begin() + 2 * stride);
+    std::copy(local_positions_.mass.begin(), local_positions_.mass.end(), ring_current_.begin() + mass_offset);
+
+    std::fill(forces_x_.begin(), forces_x_.end(), 0.0);
+    std::fill(forces_y_.begin(), forces_y_.end(), 0.0);
+    std::fill(forces_z_.begin(), forces_z_.end(), 0.0);
+    if (potential) potential_.assign(local_bodies_.size(), 0.0);
+
+    const bool mixed = precision == Precision::Mixed;
+    if (mixed) updateOrigin();
+
+    for (int round = 0; round < size; ++round) {
+        // Rank whose bodies are in the block currently held
+        const int owner = (rank + size - round) % size;
+        const bool more = round + 1 < size;
+
+        MPI_Request requests[2];
+        if (more) {
+            MPI_Irecv(ring_next_.data(), block_size, MPI_DOUBLE, left, 0, MPI_COMM_WORLD, &requests[0]);
+            MPI_Isend(ring_current_.data(), block_size, MPI_DOUBLE, right, 0, MPI_COMM_WORLD, &requests[1]);
+        }
+
+        const double* xs = ring_current_.data();
+        const double* ys = ring_current_.data() + stride;
+        const double* zs = three_d ? ring_current_.data() + 2 * stride : nullptr;
+        const double* ms = ring_current_.data() + mass_offset;
+        const std::size_t n_block = static_cast<std::size_t>(counts[owner]);
+
+        double start = MPI_Wtime();
+        if (mixed) {
+            const float* fs = ring_float_.data();
+            toFloat(xs, ys, zs, ms, static_cast<int>(n_block), ring_float_.data(), stride);
+            accumulateTiled(fs, fs + stride, three_d ? fs + 2 * stride : nullptr, fs + mass_offset,
+                            static_cast<int>(n_block), active, i_tile_, j_tile_, potential);
+        } else {
+            accumulateTiled(xs, ys, zs, ms, static_cast<int>(n_block), active, i_tile_, j_tile_, potential);
+        }
+        window_seconds_ += MPI_Wtime() - start;
+
+        if (more) {
+            MPI_Waitall(2, requests, MPI_STATUSES_IGNORE);
+            ring_current_.swap(ring_next_);
+        }
+    }
+
+    double phi_sum = 0.0;
+    #pragma omp parallel for schedule(static) reduction(+:phi_sum)
+    for (int k = 0; k < n_active; ++k) {
+        int i = active ? (*active)[k] : k;
+        double gm = options_.gravity * local_bodies_[i].mass;
+        forces_x_[i] *= gm;
+        forces_y_[i] *= gm;
+        forces_z_[i] *= gm;
+        costs_[i] += n_global;
+        if (potential) phi_sum += local_bodies_[i].mass * potential_[i];
+    }
+    // Every pair appears in the sums of both its bodies
+    if (potential) potential_energy_ = -0.5 * options_.gravity * phi_sum;
+
+    interactions_ += static_cast<std::uint64_t>(n_active) * static_cast<std::uint64_t>(n_global);
+}
+
+// Adds the unscaled sums over one block to forces_x_/y_/z_. Each thread
+// takes a tile of targets and sweeps the block in slices of j_tile bodies, so
+// a slice is reused from cache by the whole tile instead of being streamed
+// from memory once per target. With float sources the targets are taken
+// relative to the same origin as the sources. zs is null for 2D bodies. With
+// `potential` the targets' potential sums are added to potential_ as well.
+template <typename Real>
+void Simulation::accumulateTiled(const Real* xs, const Real* ys, const Real* zs, const Real* ms, int n_block,
+                                 const std::vector<int>* active, int i_tile, int j_tile, bool potential) {
+    const int n_active = active ? static_cast<int>(active->size()) : static_cast<int>(local_bodies_.size());
+    const int n_tiles = (n_active + i_tile - 1) / i_tile;
+    const bool three_d = zs != nullptr;
 
     // OpenMP Region
+    #pragma omp parallel for schedule(static)
+    for (int t = 0; t < n_tiles; ++t) {
+        const int k_begin = t * i_tile;
+        const int m = std::min(i_tile, n_active - k_begin);
+        Real xi[MAX_I_TILE], yi[MAX_I_TILE], zi[MAX_I_TILE];
+        double ax[MAX_I_TILE], ay[MAX_I_TILE], az[MAX_I_TILE], phi[MAX_I_TILE];
+
+        for (int k = 0; k < m; ++k) {
+            int i = active ? (*active)[k_begin + k] : k_begin + k;
+            if constexpr (std::is_same_v<Real, double>) {
+                xi[k] = local_bodies_[i].x;
+                yi[k] = local_bodies_[i].y;
+                zi[k] = local_bodies_[i].z;
+            } else {
+                xi[k] = static_cast<Real>(local_bodies_[i].x - origin_x_);
+                yi[k] = static_cast<Real>(local_bodies_[i].y - origin_y_);
+                zi[k] = static_cast<Real>(local_bodies_[i].z - origin_z_);
+            }
+            ax[k] = 0.0;
+            ay[k] = 0.0;
+            az[k] = 0.0;
+            phi[k] = 0.0;
+        }
+
+        // Inner Loop: Interact with every body of the block (register-blocked, SoA)
+        for (int j = 0; j < n_block; j += j_tile) {
+            std::size_t n = static_cast<std::size_t>(std::min(j_tile, n_block - j));
+            ForceKernel::accumulateMany(xs + j, ys + j, three_d ? zs + j : nullptr, ms + j, n,
+                                        xi, yi, three_d ? zi : nullptr, static_cast<std::size_t>(m),
+                                        softening_sq_, ax, ay, three_d ? az : nullptr, potential ? phi : nullptr);
+        }
+
+        for (int k = 0; k < m; ++k) {
+            int i = active ? (*active)[k_begin + k] : k_begin + k;
+            forces_x_[i] += ax[k];
+            forces_y_[i] += ay[k];
+            if (three_d) forces_z_[i] += az[k];
+            if (potential) potential_[i] += phi[k];
+        }
+    }
+}
+
+// Centre of the bounding box of all bodies, the origin of the float positions
+void Simulation::updateOrigin() {
+    // (min x, min y, min z, -max x, -max y, -max z); z is zero in 2D
+    double bounds[6] = {1e300, 1e300, 1e300, 1e300, 1e300, 1e300};
+    for (const Body& b : local_bodies_) {
+        bounds[0] = std::min(bounds[0], b.x);
+        bounds[1] = std::min(bounds[1], b.y);
+        bounds[2] = std::min(bounds[2], b.z);
+        bounds[3] = std::min(bounds[3], -b.x);
+        bounds[4] = std::min(bounds[4], -b.y);
+        bounds[5] = std::min(bounds[5], -b.z);
+    }
+    MPI_Allreduce(MPI_IN_PLACE, bounds, 6, MPI_DOUBLE, MPI_MIN, MPI_COMM_WORLD);
+    origin_x_ = 0.5 * (bounds[0] - bounds[3]);
+    origin_y_ = 0.5 * (bounds[1] - bounds[4]);
+    origin_z_ = 0.5 * (bounds[2] - bounds[5]);
+}
+
+// Packs n bodies as [x | y | mass] floats ([x | y | z | mass] when zs is
+// given) with the given stride
+void Simulation::toFloat(const double* xs, const double* ys, const double* zs, const double* ms, int n,
+                         float* out, std::size_t stride) const {
+    const std::size_t mass_offset = (zs ? 3 : 2) * stride;
+
+    #pragma omp parallel for schedule(static)
+    for (int k = 0; k < n; ++k) {
+        out[k] = static_cast<float>(xs[k] - origin_x_);
+        out[stride + k] = static_cast<float>(ys[k] - origin_y_);
+        if (zs) out[2 * stride + k] = static_cast<float>(zs[k] - origin_z_);
+        out[mass_offset + k] = static_cast<float>(ms[k]);
+    }
+}
+
+// Times every tile candidate on a sample of this rank's own bodies (the ring
+// circulates blocks of that size) and keeps rank 0's fastest so all ranks agree
+void Simulation::tuneTiles() {
+    const int n_local = static_cast<int>(local_bodies_.size());
+    if (forces_x_.size() != local_bodies_.size()) {
+        forces_x_.resize(local_bodies_.size());
+        forces_y_.resize(local_bodies_.size());
+        forces_z_.resize(local_bodies_.size());
+    }
+    packLocalPositions();
+
+    // Enough targets for a largest tile per thread and sources for two of the
+    // largest slices keep the sample short but still cache-sensitive
+    const int n_sources = std::min(n_local, 2 * J_TILE_CANDIDATES[std::size(J_TILE_CANDIDATES) - 1]);
+    std::vector<int> sample(std::min(n_local, MAX_I_TILE * omp_get_max_threads()));
+    std::iota(sample.begin(), sample.end(), 0);
+
+    const double* xs = local_positions_.x.data();
+    const double* ys = local_positions_.y.data();
+    const double* zs = local_positions_.zData();
+    const double* ms = local_positions_.mass.data();
+
+    // The mixed kernel is tuned on float copies, as the ring would hand it
+    const bool mixed = options_.precision == Precision::Mixed;
+    const std::size_t stride = static_cast<std::size_t>(n_sources);
+    std::vector<float> sources;
+    if (mixed) {
+        updateOrigin();
+        sources.resize((static_cast<std::size_t>(dimensions_) + 1) * stride);
+        toFloat(xs, ys, zs, ms, n_sources, sources.data(), stride);
+    }
+    auto sweep = [&](int i_tile, int j_tile) {
+        if (mixed) {
+            const float* fs = sources.data();
+            accumulateTiled(fs, fs + stride, zs ? fs + 2 * stride : nullptr, fs + dimensions_ * stride,
+                            n_sources, &sample, i_tile, j_tile);
+        } else {
+            accumulateTiled(xs, ys, zs, ms, n_sources, &sample, i_tile, j_tile);
+        }
+    };
+    sweep(i_tile_, j_tile_);
+
+    int best[2] = {i_tile_, j_tile_};
+    double best_time = -1.0;
+
+    for (int i_tile : I_TILE_CANDIDATES) {
+        for (int j_tile : J_TILE_CANDIDATES) {
+            double start = MPI_Wtime();
+            sweep(i_tile, j_tile);
+            double elapsed = MPI_Wtime() - start;
+            if (best_time < 0.0 || elapsed < best_time) {
+                best_time = elapsed;
+                best[0] = i_tile;
+                best[1] = j_tile;
+            }
+        }
+    }
+
+    MPI_Bcast(best, 2, MPI_INT, 0, MPI_COMM_WORLD);
+    i_tile_ = best[0];
+    j_tile_ = best[1];
+}
+
+void Simulation::computeSymmetricForces(bool potential) {
+    const int n_global = static_cast<int>(global_bodies_snapshot_.size());
+    const int rank = domain_.getRank();
+    const int size = domain_.getSize();
+
+    // The bodies are cut into blocks and each unordered block pair (I, J <= I)
+    // is one unit of work; ranks take contiguous runs of the pair list, so the
+    // work is split by pairs rather than by the bodies a rank owns
+    const int block = SYMMETRIC_BLOCK_SIZE;
+    const int n_blocks = (n_global + block - 1) / block;
+
+    if (pair_blocks_.empty() && n_blocks > 0) {
+        const long long n_pairs = static_cast<long long>(n_blocks) * (n_blocks + 1) / 2;
+        const long long first = n_pairs * rank / size;
+        const long long last = n_pairs * (rank + 1) / size;
+
+        long long k = 0;
+        for (int bi = 0; bi < n_blocks && k < last; ++bi) {
+            for (int bj = 0; bj <= bi; ++bj, ++k) {
+                if (k >= first && k < last) pair_blocks_.emplace_back(bi, bj);
+            }
+        }
+    }
+
+    const double* xs = global_bodies_snapshot_.x.data();
+    const double* ys = global_bodies_snapshot_.y.data();
+    const double* zs = global_bodies_snapshot_.zData();
+    const double* ms = global_bodies_snapshot_.mass.data();
+    const int n_pair_blocks = static_cast<int>(pair_blocks_.size());
+    const int dims = dimensions_;
+    const std::size_t fields = static_cast<std::size_t>(dims) + (potential ? 1 : 0);
+    std::uint64_t pairs = 0;
+
+    // Each thread accumulates into its own buffer ([ax | ay (| az) (| phi)]
+    // over all bodies) since both bodies of a pair receive a contribution
+    #pragma omp parallel reduction(+:pairs)
+    {
+        #pragma omp single
+        thread_forces_.resize(omp_get_num_threads());
+
+        std::vector<double>& local = thread_forces_[omp_get_thread_num()];
+        local.assign(fields * n_global, 0.0);
+        double* ax = local.data();
+        double* ay = local.data() + n_global;
+        double* az = zs ? local.data() + 2 * static_cast<std::size_t>(n_global) : nullptr;
+        double* phi = potential ? local.data() + static_cast<std::size_t>(dims) * n_global : nullptr;
+
+        #pragma omp for schedule(dynamic)
+        for (int p = 0; p < n_pair_blocks; ++p) {
+            auto [bi, bj] = pair_blocks_[p];
+            std::size_t i_begin = static_cast<std::size_t>(bi) * block;
+            std::size_t i_end = std::min<std::size_t>(i_begin + block, n_global);
+            std::size_t j_begin = static_cast<std::size_t>(bj) * block;
+            std::size_t j_end = std::min<std::size_t>(j_begin + block, n_global);
+
+            ForceKernel::accumulatePairs(xs, ys, zs, ms, i_begin, i_end, j_begin, j_end, softening_sq_, ax, ay, az, phi);
+
+            std::uint64_t ni = i_end - i_begin;
+            std::uint64_t nj = j_end - j_begin;
+            pairs += bi == bj ? ni * (ni - 1) / 2 : ni * nj;
+        }
+    }
+
+    // Sum the thread buffers, interleaved as (ax, ay[, az]) per body for the
+    // reduce-scatter. The potential energy is a plain sum, this rank's pairs
+    // give its share.
+    rank_forces_.resize(static_cast<std::size_t>(dims) * n_global);
+    const int n_threads = static_cast<int>(thread_forces_.size());
+    double phi_sum = 0.0;
+
+    #pragma omp parallel for schedule(static) reduction(+:phi_sum)
+    for (int j = 0; j < n_global; ++j) {
+        for (int d = 0; d < dims; ++d) {
+            double a = 0.0;
+            for (int t = 0; t < n_threads; ++t) {
+                a += thread_forces_[t][static_cast<std::size_t>(d) * n_global + j];
+            }
+            rank_forces_[static_cast<std::size_t>(dims) * j + d] = a;
+        }
+        if (potential) {
+            for (int t = 0; t < n_threads; ++t) {
+                phi_sum += ms[j] * thread_forces_[t][static_cast<std::size_t>(dims) * n_global + j];
+            }
+        }
+    }
+    if (potential) potential_energy_ = -0.5 * options_.gravity * phi_sum;
+
+    // Every rank receives the summed accelerations of the bodies it owns
+    auto [counts, displs] = domain_.getcv(n_global);
+    for (int& c : counts) c *= dims;
+    int n_local = static_cast<int>(local_bodies_.size());
+    std::vector<double> local_acc(static_cast<std::size_t>(dims) * n_local);
+
+    MPI_Reduce_scatter(rank_forces_.data(), local_acc.data(), counts.data(), MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
+
     #pragma omp parallel for schedule(static)
     for (int i = 0; i < n_local; ++i) {
-        double fx = 0.0;
-        double fy = 0.0;
-        
-        // Load local body data into registers
-        double xi = local_bodies_[i].x;
-        double yi = local_bodies_[i].y;
-        double mi = local_bodies_[i].mass;
-        
-        // Global index of current body
-        size_t global_i = my_offset + i;
-
-        // Inner Loop: Interact with ALL global bodies
-        for (int j = 0; j < n_global; ++j) {
-            // Avoid self-interaction
-            if (static_cast<int>(global_i) == j) continue;
-
-            double dx = global_bodies_snapshot_[j].x - xi;
-            double dy = global_bodies_snapshot_[j].y - yi;
-            
-            // Softened distance
-            double dist_sq = dx*dx + dy*dy + (SOFTENING * SOFTENING);
-            
-            // 1/r^3
-            double dist = std::sqrt(dist_sq);
-            double dist_cb = dist * dist * dist;
-
-            double f = (G * mi * global_bodies_snapshot_[j].mass) / dist_cb;
-            
-            fx += f * dx;
-            fy += f * dy;
+        double gm = options_.gravity * local_bodies_[i].mass;
+        forces_x_[i] = gm * local_acc[static_cast<std::size_t>(dims) * i];
+        forces_y_[i] = gm * local_acc[static_cast<std::size_t>(dims) * i + 1];
+        if (dims == 3) forces_z_[i] = gm * local_acc[3 * static_cast<std::size_t>(i) + 2];
+    }
+
+    // Each pair yields two forces; counted twice to compare with the direct solver
+    interactions_ += 2 * pairs;
+}
+
+void Simulation::computeTreeForces(const std::vector<int>* active, bool potential) {
+    int n_local = static_cast<int>(local_bodies_.size());
+    int n_active = active ? static_cast<int>(active->size()) : n_local;
+
+    // Every rank builds the full tree from the replicated snapshot
+    tree_->build(global_bodies_snapshot_);
+
+    std::uint64_t interactions = 0;
+    double phi_sum = 0.0;
+    double start = MPI_Wtime();
+
+    // Traversal cost varies with local density, hence the dynamic schedule
+    #pragma omp parallel for schedule(dynamic, 64) reduction(+:interactions, phi_sum)
+    for (int k = 0; k < n_active; ++k) {
+        int i = active ? (*active)[k] : k;
+        double ax = 0.0;
+        double ay = 0.0;
+        double phi = 0.0;
+
+        std::uint64_t count = tree_->accumulate(local_bodies_[i].x, local_bodies_[i].y, ax, ay,
+                                                potential ? &phi : nullptr);
+        interactions += count;
+        costs_[i] += static_cast<double>(count);
+
+        double gm = options_.gravity * local_bodies_[i].mass;
+        forces_x_[i] = gm * ax;
+        forces_y_[i] = gm * ay;
+        phi_sum += local_bodies_[i].mass * phi;
+    }
+
+    window_seconds_ += MPI_Wtime() - start;
+    interactions_ += interactions;
+    if (potential) potential_energy_ = -0.5 * options_.gravity * phi_sum;
+}
+
+void Simulation::reportForceError() {
+    exchangePositions();
+    computeForces();
+    std::vector<double> approx_x = forces_x_;
+    std::vector<double> approx_y = forces_y_;
+    std::vector<double> approx_z = forces_z_;
+    computeDirectForces(nullptr, Precision::Double);
+
+    // Relative error of each body's force vector against the direct sum
+    int n_local = static_cast<int>(local_bodies_.size());
+    double sum_sq = 0.0;
+    double max_err = 0.0;
+
+    #pragma omp parallel for reduction(+:sum_sq) reduction(max:max_err)
+    for (int i = 0; i < n_local; ++i) {
+        double ex = approx_x[i] - forces_x_[i];
+        double ey = approx_y[i] - forces_y_[i];
+        double ez = approx_z[i] - forces_z_[i];
+        double norm = std::sqrt(forces_x_[i] * forces_x_[i] + forces_y_[i] * forces_y_[i] +
+                                forces_z_[i] * forces_z_[i]);
+        double err = norm > 0.0 ? std::sqrt(ex*ex + ey*ey + ez*ez) / norm : 0.0;
+        sum_sq += err * err;
+        max_err = std::max(max_err, err);
+    }
+
+    double global_sum = 0.0;
+    double global_max = 0.0;
+    MPI_Reduce(&sum_sq, &global_sum, 1, MPI_DOUBLE, MPI_SUM, 0, MPI_COMM_WORLD);
+    MPI_Reduce(&max_err, &global_max, 1, MPI_DOUBLE, MPI_MAX, 0, MPI_COMM_WORLD);
+
+    if (domain_.getRank() == 0) {
+        double n = static_cast<double>(global_bodies_snapshot_.size());
+        std::cout << " Force error: rms " << std::scientific << std::setprecision(2)
+                  << std::sqrt(global_sum / std::max(n, 1.0)) << ", max " << global_max
+                  << " (relative to direct)\n" << std::defaultfloat;
+        std::cout << "----------------------------------------\n";
+    }
+}
+
+// Moves the boundaries between the ranks' ranges so that every rank gets the
+// same share of the force time measured since the last call. A body weighs its
+// cost (interactions received) times its rank's seconds per interaction, which
+// covers uneven work per body (tree, block timesteps) as well as ranks of
+// different speed. Ranges stay contiguous in the global order, so the output
+// order is unchanged and bodies only move across the shifted boundaries.
+void Simulation::rebalance() {
+    const int rank = domain_.getRank();
+    const int size = domain_.getSize();
+    const int n_local = static_cast<int>(local_bodies_.size());
+
+    const double local_cost = std::accumulate(costs_.begin(), costs_.end(), 0.0);
+    double local[2] = {window_seconds_, local_cost};
+    double sums[2] = {0.0, 0.0};
+    double max_seconds = 0.0;
+    MPI_Allreduce(local, sums, 2, MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
+    MPI_Allreduce(&window_seconds_, &max_seconds, 1, MPI_DOUBLE, MPI_MAX, MPI_COMM_WORLD);
+
+    force_seconds_ += window_seconds_;
+    window_seconds_ = 0.0;
+
+    const double mean_seconds = sums[0] / size;
+    const double imbalance = mean_seconds > 0.0 ? max_seconds / mean_seconds : 1.0;
+    if (first_imbalance_ < 0.0) first_imbalance_ = imbalance;
+
+    if (imbalance < REBALANCE_THRESHOLD || sums[1] <= 0.0) {
+        std::fill(costs_.begin(), costs_.end(), 0.0);
+        return;
+    }
+
+    // A rank without measured work is assumed to run at the average rate
+    const double rate = local_cost > 0.0 ? local[0] / local_cost : sums[0] / sums[1];
+    double local_weight = local_cost * rate;
+    double offset = 0.0;
+    double total_weight = 0.0;
+    MPI_Exscan(&local_weight, &offset, 1, MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
+    MPI_Allreduce(&local_weight, &total_weight, 1, MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
+    if (rank == 0) offset = 0.0;
+
+    // Each body goes to the rank whose equal share of the weight holds its midpoint
+    std::vector<int> send_counts(size, 0);
+    for (int i = 0; i < n_local; ++i) {
+        double weight = costs_[i] * rate;
+        double mid = offset + 0.5 * weight;
+        int dest = static_cast<int>(mid / total_weight * size);
+        ++send_counts[std::clamp(dest, 0, size - 1)];
+        offset += weight;
+    }
+
+    std::uint64_t moved = static_cast<std::uint64_t>(n_local - send_counts[rank]);
+    std::uint64_t total_moved = 0;
+    MPI_Allreduce(&moved, &total_moved, 1, MPI_UINT64_T, MPI_SUM, MPI_COMM_WORLD);
+
+    migrate(send_counts);
+    std::fill(costs_.begin(), costs_.end(), 0.0);
+
+    ++rebalances_;
+    migrated_ += total_moved;
+}
+
+// Sends the first send_counts[0] local bodies to rank 0, the next
+// send_counts[1] to rank 1 and so on, together with their integrator state,
+// cost, input index and (when given) key. Received bodies are stored in rank
+// order, so a rank's range stays contiguous in the global order as long as
+// every rank sends contiguous runs.
+void Simulation::migrate(const std::vector<int>& send_counts, std::vector<std::uint64_t>* keys) {
+    const int size = domain_.getSize();
+    const int n_local = static_cast<int>(local_bodies_.size());
+    const int n_global = static_cast<int>(global_bodies_snapshot_.size());
+    const int n_ids = keys ? 2 : 1;
+
+    std::vector<int> recv_counts(size);
+    MPI_Alltoall(send_counts.data(), 1, MPI_INT, recv_counts.data(), 1, MPI_INT, MPI_COMM_WORLD);
+
+    std::vector<int> send_displs(size);
+    std::vector<int> recv_displs(size);
+    std::exclusive_scan(send_counts.begin(), send_counts.end(), send_displs.begin(), 0);
+    std::exclusive_scan(recv_counts.begin(), recv_counts.end(), recv_displs.begin(), 0);
+    const int n_new = recv_displs[size - 1] + recv_counts[size - 1];
+
+    SystemState incoming(n_new);
+    MPI_Datatype body_type = Body::mpiType();
+    MPI_Alltoallv(local_bodies_.data(), send_counts.data(), send_displs.data(), body_type,
+                  incoming.data(), recv_counts.data(), recv_displs.data(), body_type, MPI_COMM_WORLD);
+
+    // The integrator state travels with its body, so the next step continues exactly
+    std::vector<double> state_out(static_cast<std::size_t>(n_local) * MIGRATED_FIELDS);
+    std::vector<double> state_in(static_cast<std::size_t>(n_new) * MIGRATED_FIELDS);
+    std::vector<std::uint64_t> ids_out(static_cast<std::size_t>(n_local) * n_ids);
+    std::vector<std::uint64_t> ids_in(static_cast<std::size_t>(n_new) * n_ids);
+    for (int i = 0; i < n_local; ++i) {
+        double* out = &state_out[static_cast<std::size_t>(i) * MIGRATED_FIELDS];
+        out[0] = levels_[i];
+        out[1] = last_acc_x_[i];
+        out[2] = last_acc_y_[i];
+        out[3] = last_acc_z_[i];
+        out[4] = forces_x_[i];
+        out[5] = forces_y_[i];
+        out[6] = forces_z_[i];
+        out[7] = costs_[i];
+        ids_out[static_cast<std::size_t>(i) * n_ids] = ids_[i];
+        if (keys) ids_out[static_cast<std::size_t>(i) * n_ids + 1] = (*keys)[i];
+    }
+
+    auto scaled = [size](const std::vector<int>& v, int factor) {
+        std::vector<int> out(size);
+        for (int r = 0; r < size; ++r) out[r] = v[r] * factor;
+        return out;
+    };
+    MPI_Alltoallv(state_out.data(), scaled(send_counts, MIGRATED_FIELDS).data(),
+                  scaled(send_displs, MIGRATED_FIELDS).data(), MPI_DOUBLE,
+                  state_in.data(), scaled(recv_counts, MIGRATED_FIELDS).data(),
+                  scaled(recv_displs, MIGRATED_FIELDS).data(), MPI_DOUBLE, MPI_COMM_WORLD);
+    MPI_Alltoallv(ids_out.data(), scaled(send_counts, n_ids).data(), scaled(send_displs, n_ids).data(), MPI_UINT64_T,
+                  ids_in.data(), scaled(recv_counts, n_ids).data(), scaled(recv_displs, n_ids).data(), MPI_UINT64_T,
+                  MPI_COMM_WORLD);
+
+    std::vector<int> counts(size);
+    MPI_Allgather(&n_new, 1, MPI_INT, counts.data(), 1, MPI_INT, MPI_COMM_WORLD);
+    domain_.setCounts(counts);
+
+    local_bodies_ = std::move(incoming);
+    resizeLocalState(n_global);
+    levels_.resize(n_new);
+    last_acc_x_.resize(n_new);
+    last_acc_y_.resize(n_new);
+    last_acc_z_.resize(n_new);
+    costs_.resize(n_new);
+    ids_.resize(n_new);
+    if (keys) keys->resize(n_new);
+    for (int i = 0; i < n_new; ++i) {
+        const double* in = &state_in[static_cast<std::size_t>(i) * MIGRATED_FIELDS];
+        levels_[i] = static_cast<int>(in[0]);
+        last_acc_x_[i] = in[1];
+        last_acc_y_[i] = in[2];
+        last_acc_z_[i] = in[3];
+        forces_x_[i] = in[4];
+        forces_y_[i] = in[5];
+        forces_z_[i] = in[6];
+        costs_[i] = in[7];
+        ids_[i] = ids_in[static_cast<std::size_t>(i) * n_ids];
+        if (keys) (*keys)[i] = ids_in[static_cast<std::size_t>(i) * n_ids + 1];
+    }
+}
+
+// Parallel radix sort of the bodies by key across all ranks. Each rank sorts
+// its bodies locally, a global histogram of the top SORT_HISTOGRAM_BITS key
+// bits assigns every bucket to a rank so that each gets about N / size bodies,
+// the bodies are exchanged and the received runs sorted again. A last
+// exchange moves the range boundaries to the even split by count.
+void Simulation::sortBodies(std::vector<std::uint64_t>& keys) {
+    const int rank = domain_.getRank();
+    const int size = domain_.getSize();
+    const int n_global = static_cast<int>(global_bodies_snapshot_.size());
+
+    auto sortLocal = [this, &keys]() {
+        std::vector<int> order;
+        SpaceFillingCurve::radixOrder(keys, order);
+        auto permute = [&order](auto& v) {
+            std::remove_reference_t<decltype(v)> out(v.size());
+            for (std::size_t k = 0; k < order.size(); ++k) out[k] = v[order[k]];
+            v.swap(out);
+        };
+        permute(local_bodies_);
+        permute(levels_);
+        permute(last_acc_x_);
+        permute(last_acc_y_);
+        permute(last_acc_z_);
+        permute(forces_x_);
+        permute(forces_y_);
+        permute(forces_z_);
+        permute(costs_);
+        permute(ids_);
+        permute(keys);
+    };
+
+    sortLocal();
+
+    std::uint64_t local_max = keys.empty() ? 0 : keys.back();
+    std::uint64_t max_key = 0;
+    MPI_Allreduce(&local_max, &max_key, 1, MPI_UINT64_T, MPI_MAX, MPI_COMM_WORLD);
+    int shift = 0;
+    while ((max_key >> shift) >= (1ull << SORT_HISTOGRAM_BITS)) ++shift;
+
+    std::vector<std::uint64_t> histogram(std::size_t(1) << SORT_HISTOGRAM_BITS, 0);
+    for (std::uint64_t key : keys) ++histogram[key >> shift];
+    MPI_Allreduce(MPI_IN_PLACE, histogram.data(), static_cast<int>(histogram.size()), MPI_UINT64_T, MPI_SUM,
+                  MPI_COMM_WORLD);
+
+    // A bucket goes to the rank whose even share of the bodies holds its midpoint
+    std::vector<int> bucket_rank(histogram.size());
+    std::uint64_t before = 0;
+    for (std::size_t b = 0; b < histogram.size(); ++b) {
+        double mid = static_cast<double>(before) + 0.5 * static_cast<double>(histogram[b]);
+        bucket_rank[b] = std::clamp(static_cast<int>(mid * size / std::max(n_global, 1)), 0, size - 1);
+        before += histogram[b];
+    }
+
+    std::vector<int> send_counts(size, 0);
+    for (std::uint64_t key : keys) ++send_counts[bucket_rank[key >> shift]];
+    migrate(send_counts, &keys);
+    sortLocal();
+
+    // Whole buckets may still leave the ranks uneven; shift to the even split
+    DomainDecomposition even(rank, size);
+    auto [counts, displs] = even.getcv(n_global);
+    long long first = 0;
+    long long n_local = static_cast<long long>(local_bodies_.size());
+    MPI_Exscan(&n_local, &first, 1, MPI_LONG_LONG, MPI_SUM, MPI_COMM_WORLD);
+    if (rank == 0) first = 0;
+
+    for (int r = 0; r < size; ++r) {
+        long long lo = std::max<long long>(first, displs[r]);
+        long long hi = std::min<long long>(first + n_local, static_cast<long long>(displs[r]) + counts[r]);
+        send_counts[r] = static_cast<int>(std::max(0LL, hi - lo));
+    }
+    migrate(send_counts);
+}
+
+// Sorts the bodies along the configured curve over the global bounding box
+void Simulation::reorderByCurve() {
+    double start = MPI_Wtime();
+    const int n_local = static_cast<int>(local_bodies_.size());
+
+    // One MIN reduction for both corners: (min x, min y, -max x, -max y)
+    double bounds[4] = {1e300, 1e300, 1e300, 1e300};
+    for (const Body& b : local_bodies_) {
+        bounds[0] = std::min(bounds[0], b.x);
+        bounds[1] = std::min(bounds[1], b.y);
+        bounds[2] = std::min(bounds[2], -b.x);
+        bounds[3] = std::min(bounds[3], -b.y);
+    }
+    MPI_Allreduce(MPI_IN_PLACE, bounds, 4, MPI_DOUBLE, MPI_MIN, MPI_COMM_WORLD);
+
+    // Square cells, so the curve's locality holds in both directions
+    const double cells = static_cast<double>((1u << SpaceFillingCurve::BITS) - 1);
+    const double extent = std::max(-bounds[2] - bounds[0], -bounds[3] - bounds[1]);
+    const double scale = extent > 0.0 ? cells / extent : 0.0;
+
+    std::vector<std::uint64_t> keys(n_local);
+    const bool hilbert = options_.ordering == Ordering::Hilbert;
+
+    #pragma omp parallel for schedule(static)
+    for (int i = 0; i < n_local; ++i) {
+        auto ix = static_cast<std::uint32_t>(std::clamp((local_bodies_[i].x - bounds[0]) * scale, 0.0, cells));
+        auto iy = static_cast<std::uint32_t>(std::clamp((local_bodies_[i].y - bounds[1]) * scale, 0.0, cells));
+        keys[i] = hilbert ? SpaceFillingCurve::hilbert(ix, iy) : SpaceFillingCurve::morton(ix, iy);
+    }
+
+    sortBodies(keys);
+    curve_ordered_ = true;
+    ++sorts_;
+    sort_seconds_ += MPI_Wtime() - start;
+}
+
+// Sorts by input index, which brings back the input order and the even split
+void Simulation::restoreInputOrder() {
+    double start = MPI_Wtime();
+    std::vector<std::uint64_t> keys = ids_;
+    sortBodies(keys);
+    curve_ordered_ = false;
+    ++sorts_;
+    sort_seconds_ += MPI_Wtime() - start;
+}
+
+void Simulation::advance(double dt) {
+    if (options_.block_levels > 0) {
+        blockStep(dt);
+        return;
+    }
+
+    switch (options_.integrator) {
+        case Integrator::Leapfrog:
+            kickDriftKick(dt);
+            break;
+        case Integrator::Yoshida4: {
+            // Only the last substep's force pass sees the positions at the end of the step
+            const bool potential_due = potential_due_;
+            potential_due_ = false;
+            kickDriftKick(YOSHIDA_W1 * dt);
+            kickDriftKick(YOSHIDA_W0 * dt);
+            potential_due_ = potential_due;
+            kickDriftKick(YOSHIDA_W1 * dt);
+            break;
         }
-        
-        forces_x_[i] = fx;
-        forces_y_[i] = fy;
+        default:
+            // Forces are only current after a diagnostics pass (recordDiagnostics)
+            if (!forces_current_) computeForces();
+            kick(dt);
+            drift(dt);
+            forces_current_ = false;
+            break;
     }
 }
 
-void Simulation::updatePositions(double dt) {
+// The closing kick's forces are those of the next opening kick, so after the
+// first step every leapfrog step costs one force pass
+void Simulation::kickDriftKick(double dt) {
+    if (!forces_current_) computeForces();
+    kick(0.5 * dt);
+    drift(dt);
+    computeForces();
+    kick(0.5 * dt);
+    forces_current_ = true;
+}
+
+// Hierarchical leapfrog: the global step is cut into 2^K substeps and a body on
+// level l takes steps of dt / 2^l, so its step ends every 2^(K-l) substeps.
+// Every body drifts each substep; only bodies whose step ends get new forces,
+// a closing kick, a new level and the opening kick of their next step.
+void Simulation::blockStep(double dt) {
+    const int max_level = options_.block_levels;
+    const int substeps = 1 << max_level;
+    const double h = dt / substeps;
+    const int n_local = static_cast<int>(local_bodies_.size());
+
+    if (!forces_current_) {
+        computeForces();
+        body_updates_ += static_cast<std::uint64_t>(n_local);
+    }
+
+    // All bodies are synchronised at the start of the global step
+    #pragma omp parallel for schedule(static)
+    for (int i = 0; i < n_local; ++i) {
+        levels_[i] = chooseLevel(i, dt, 0);
+        double half = 0.5 * dt / (1 << levels_[i]) / local_bodies_[i].mass;
+        local_bodies_[i].vx += forces_x_[i] * half;
+        local_bodies_[i].vy += forces_y_[i] * half;
+        local_bodies_[i].vz += forces_z_[i] * half;
+    }
+
+    for (int t = 1; t <= substeps; ++t) {
+        drift(h);
+
+        active_.clear();
+        for (int i = 0; i < n_local; ++i) {
+            if (t % (substeps >> levels_[i]) == 0) active_.push_back(i);
+        }
+
+        // The force pass is collective, so every rank joins if any body is due
+        int local_due = active_.empty() ? 0 : 1;
+        int any_due = 0;
+        MPI_Allreduce(&local_due, &any_due, 1, MPI_INT, MPI_MAX, MPI_COMM_WORLD);
+        if (!any_due) continue;
+
+        computeForces(&active_);
+        body_updates_ += active_.size();
+
+        const int n_active = static_cast<int>(active_.size());
+        #pragma omp parallel for schedule(static)
+        for (int k = 0; k < n_active; ++k) {
+            int i = active_[k];
+            double inv_mass = 1.0 / local_bodies_[i].mass;
+            double half = 0.5 * dt / (1 << levels_[i]);
+
+            // At the end of the global step the opening kick belongs to the next one
+            if (t < substeps) {
+                levels_[i] = chooseLevel(i, dt, t);
+                half += 0.5 * dt / (1 << levels_[i]);
+            }
+            local_bodies_[i].vx += forces_x_[i] * inv_mass * half;
+            local_bodies_[i].vy += forces_y_[i] * inv_mass * half;
+            local_bodies_[i].vz += forces_z_[i] * inv_mass * half;
+        }
+    }
+
+    // Every step ends with the global one, so all forces are current
+    forces_current_ = true;
+}
+
+// Aarseth-style criterion dt_i = eta |a| / |da/dt|, with da/dt the change of
+// acceleration over the body's previous step. A body without a previous step
+// starts on the finest level, and a body coarsens by at most one level per
+// step and only on a substep that is a boundary of the coarser level.
+int Simulation::chooseLevel(int i, double dt, int substep) {
+    const int max_level = options_.block_levels;
+    const int substeps = 1 << max_level;
+    const int current = levels_[i];
+
+    double inv_mass = 1.0 / local_bodies_[i].mass;
+    double ax = forces_x_[i] * inv_mass;
+    double ay = forces_y_[i] * inv_mass;
+    double az = forces_z_[i] * inv_mass;
+    auto norm = [this](double x, double y, double z) {
+        return dimensions_ == 3 ? std::hypot(x, y, z) : std::hypot(x, y);
+    };
+
+    int level = max_level;
+    if (current >= 0) {
+        double step = dt / (1 << current);
+        double jerk = norm(ax - last_acc_x_[i], ay - last_acc_y_[i], az - last_acc_z_[i]) / step;
+
+        level = 0;
+        if (jerk > 0.0) {
+            double wanted = options_.eta * norm(ax, ay, az) / jerk;
+            while (level < max_level && dt / (1 << level) > wanted) ++level;
+        }
+        level = std::max(level, current - 1);
+    }
+
+    while (level < max_level && substep % (substeps >> level) != 0) ++level;
+
+    last_acc_x_[i] = ax;
+    last_acc_y_[i] = ay;
+    last_acc_z_[i] = az;
+    return level;
+}
+
+void Simulation::kick(double dt) {
     int n_local = static_cast<int>(local_bodies_.size());
 
     #pragma omp parallel for schedule(static)
@@ -179,13 +1412,24 @@ void Simulation::updatePositions(double dt) {
         double inv_mass = 1.0 / local_bodies_[i].mass;
         double ax = forces_x_[i] * inv_mass;
         double ay = forces_y_[i] * inv_mass;
+        double az = forces_z_[i] * inv_mass;
 
         local_bodies_[i].vx += ax * dt;
         local_bodies_[i].vy += ay * dt;
+        local_bodies_[i].vz += az * dt;
+    }
+}
 
+void Simulation::drift(double dt) {
+    int n_local = static_cast<int>(local_bodies_.size());
+
+    #pragma omp parallel for schedule(static)
+    for (int i = 0; i < n_local; ++i) {
         local_bodies_[i].x += local_bodies_[i].vx * dt;
         local_bodies_[i].y += local_bodies_[i].vy * dt;
+        local_bodies_[i].z += local_bodies_[i].vz * dt;
     }
+    potential_current_ = false;
 }
 
 SystemState Simulation::gatherFinalState() const {
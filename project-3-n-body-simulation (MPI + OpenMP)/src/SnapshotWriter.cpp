@@ -0,0 +1,156 @@
+#include "nbody/SnapshotWriter.hpp"
+#include "nbody/IO.hpp"
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <stdexcept>
+#include <unistd.h>
+
+namespace nbody {
+
+namespace {
+
+// pwrite() may write less than asked, so loop until the range is done
+void writeAll(int fd, const void* data, std::size_t bytes, off_t offset, const std::string& filename) {
+    const char* p = static_cast<const char*>(data);
+    while (bytes > 0) {
+        ssize_t n = ::pwrite(fd, p, bytes, offset);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            throw std::runtime_error("Error writing " + filename + ": " + std::strerror(errno));
+        }
+        p += n;
+        bytes -= static_cast<std::size_t>(n);
+        offset += n;
+    }
+}
+
+} // namespace
+
+SnapshotWriter::SnapshotWriter(const DomainDecomposition& domain, std::string prefix)
+    : domain_(domain), prefix_(std::move(prefix)) {
+    thread_ = std::thread(&SnapshotWriter::loop, this);
+}
+
+SnapshotWriter::~SnapshotWriter() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+    changed_.notify_all();
+    thread_.join();
+}
+
+void SnapshotWriter::submit(const SystemState& local_bodies, std::size_t first_body, std::size_t total_bodies,
+                            int dimensions, double dt, int steps, std::uint64_t step) {
+    auto start = std::chrono::steady_clock::now();
+    std::unique_lock<std::mutex> lock(mutex_);
+    changed_.wait(lock, [this] { return pending_.size() < MAX_PENDING || !error_.empty(); });
+    stall_seconds_ += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    if (!error_.empty()) {
+        throw std::runtime_error(error_);
+    }
+
+    Job job;
+    if (!spare_.empty()) {
+        job.records = std::move(spare_.back());
+        spare_.pop_back();
+    }
+    lock.unlock();
+
+    char suffix[32];
+    std::snprintf(suffix, sizeof(suffix), "_%06llu.nbody", static_cast<unsigned long long>(step));
+    job.filename = prefix_ + suffix;
+    job.first_body = first_body;
+    job.total_bodies = total_bodies;
+    job.dimensions = dimensions;
+    job.dt = dt;
+    job.steps = steps;
+    job.step = step;
+    IO::packRecords(local_bodies, dimensions, job.records);
+
+    lock.lock();
+    pending_.push_back(std::move(job));
+    lock.unlock();
+    changed_.notify_all();
+}
+
+void SnapshotWriter::finish() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    changed_.wait(lock, [this] { return (pending_.empty() && !busy_) || !error_.empty(); });
+    if (!error_.empty()) {
+        throw std::runtime_error(error_);
+    }
+}
+
+std::size_t SnapshotWriter::written() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return written_;
+}
+
+void SnapshotWriter::loop() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    for (;;) {
+        changed_.wait(lock, [this] { return !pending_.empty() || stop_; });
+        if (pending_.empty()) return;
+
+        // The job stays queued while it is written, which keeps submit's bound honest
+        busy_ = true;
+        const Job& job = pending_.front();
+        lock.unlock();
+
+        std::string error;
+        try {
+            write(job);
+        } catch (const std::exception& e) {
+            error = e.what();
+        }
+
+        lock.lock();
+        busy_ = false;
+        if (error.empty()) {
+            ++written_;
+        } else if (error_.empty()) {
+            error_ = error;
+        }
+        spare_.push_back(std::move(pending_.front().records));
+        pending_.pop_front();
+        changed_.notify_all();
+    }
+}
+
+void SnapshotWriter::write(const Job& job) const {
+    int fd = ::open(job.filename.c_str(), O_WRONLY | O_CREAT, 0644);
+    if (fd < 0) {
+        throw std::runtime_error("Could not open snapshot " + job.filename + ": " + std::strerror(errno));
+    }
+
+    const std::size_t record_bytes = IO::stateFields(job.dimensions) * sizeof(double);
+    const off_t offset = static_cast<off_t>(IO::BINARY_HEADER_SIZE + job.first_body * record_bytes);
+
+    try {
+        writeAll(fd, job.records.data(), job.records.size() * sizeof(double), offset, job.filename);
+
+        // Rank 0 also owns the header and trims whatever an older, larger file left behind
+        if (domain_.getRank() == 0) {
+            BinaryHeader header = IO::makeBinaryHeader(job.total_bodies, job.dimensions, job.dt, job.steps, job.step);
+            writeAll(fd, &header, sizeof(header), 0, job.filename);
+            off_t size = static_cast<off_t>(IO::BINARY_HEADER_SIZE + job.total_bodies * record_bytes);
+            if (::ftruncate(fd, size) != 0) {
+                throw std::runtime_error("Could not size snapshot " + job.filename + ": " + std::strerror(errno));
+            }
+        }
+    } catch (...) {
+        ::close(fd);
+        throw;
+    }
+
+    if (::close(fd) != 0) {
+        throw std::runtime_error("Error closing snapshot " + job.filename + ": " + std::strerror(errno));
+    }
+}
+
+} // namespace nbody
@@ -0,0 +1,80 @@
+#include "nbody/SpaceFillingCurve.hpp"
+#include <numeric>
+#include <utility>
+
+namespace nbody {
+
+namespace {
+
+// Spreads the low 32 bits of v to the even bit positions
+std::uint64_t spreadBits(std::uint64_t v) {
+    v &= 0xFFFFFFFFull;
+    v = (v | (v << 16)) & 0x0000FFFF0000FFFFull;
+    v = (v | (v << 8)) & 0x00FF00FF00FF00FFull;
+    v = (v | (v << 4)) & 0x0F0F0F0F0F0F0F0Full;
+    v = (v | (v << 2)) & 0x3333333333333333ull;
+    v = (v | (v << 1)) & 0x5555555555555555ull;
+    return v;
+}
+
+} // namespace
+
+std::uint64_t SpaceFillingCurve::morton(std::uint32_t ix, std::uint32_t iy) {
+    return spreadBits(ix) | (spreadBits(iy) << 1);
+}
+
+// Walks the quadrants from the top bit down, rotating and reflecting the
+// remaining coordinates into the orientation of the sub-curve
+std::uint64_t SpaceFillingCurve::hilbert(std::uint32_t ix, std::uint32_t iy) {
+    const std::uint32_t mask = (1u << BITS) - 1;
+    std::uint32_t x = ix & mask;
+    std::uint32_t y = iy & mask;
+    std::uint64_t d = 0;
+
+    for (std::uint32_t s = 1u << (BITS - 1); s > 0; s >>= 1) {
+        std::uint32_t rx = (x & s) ? 1 : 0;
+        std::uint32_t ry = (y & s) ? 1 : 0;
+        d += static_cast<std::uint64_t>(s) * s * ((3 * rx) ^ ry);
+
+        if (ry == 0) {
+            if (rx == 1) {
+                x = mask - x;
+                y = mask - y;
+            }
+            std::swap(x, y);
+        }
+    }
+    return d;
+}
+
+void SpaceFillingCurve::radixOrder(const std::vector<std::uint64_t>& keys, std::vector<int>& order) {
+    const int n = static_cast<int>(keys.size());
+    order.resize(n);
+    std::iota(order.begin(), order.end(), 0);
+
+    // A bit varies between keys exactly where OR and AND of all keys differ
+    std::uint64_t any = 0;
+    std::uint64_t all = ~0ull;
+    for (std::uint64_t key : keys) {
+        any |= key;
+        all &= key;
+    }
+    const std::uint64_t varying = any ^ all;
+
+    std::vector<int> scratch(n);
+    for (int shift = 0; shift < 64; shift += 8) {
+        if (((varying >> shift) & 0xFF) == 0) continue;
+
+        int count[257] = {};
+        for (int k = 0; k < n; ++k) {
+            ++count[((keys[order[k]] >> shift) & 0xFF) + 1];
+        }
+        std::partial_sum(count, count + 257, count);
+        for (int k = 0; k < n; ++k) {
+            scratch[count[(keys[order[k]] >> shift) & 0xFF]++] = order[k];
+        }
+        order.swap(scratch);
+    }
+}
+
+} // namespace nbody
@@ -2,6 +2,7 @@
 #include <mpi.h>
 #include <string>
 #include <algorithm> // For std::find
+#include <cstdlib>
 
 #include "nbody/Simulation.hpp"
 #include "nbody/IO.hpp"
@@ -15,6 +16,10 @@ std::string getCmdOption(char ** begin, char ** end, const std::string & option)
     return "";
 }
 
+bool cmdOptionExists(char ** begin, char ** end, const std::string & option) {
+    return std::find(begin, end, option) != end;
+}
+
 int main(int argc, char** argv) {
     MPI_Init(&argc, &argv);
 
@@ -30,41 +35,272 @@ int main(int argc, char** argv) {
     std::string o_arg = getCmdOption(argv, argv + argc, "-o");
     if (!o_arg.empty()) output_file = o_arg;
 
+    // Solver selection: --solver direct|symmetric|barnes-hut, --theta <angle>, --compare-direct
+    nbody::SimulationOptions options;
+    std::string solver_arg = getCmdOption(argv, argv + argc, "--solver");
+    if (solver_arg == "barnes-hut" || solver_arg == "bh") {
+        options.solver = nbody::Solver::BarnesHut;
+    } else if (solver_arg == "symmetric") {
+        options.solver = nbody::Solver::Symmetric;
+    } else if (!solver_arg.empty() && solver_arg != "direct") {
+        if (rank == 0) std::cerr << "[Error] Unknown solver: " << solver_arg << " (expected direct, symmetric or barnes-hut)\n";
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+    std::string theta_arg = getCmdOption(argv, argv + argc, "--theta");
+    if (!theta_arg.empty()) {
+        options.theta = std::atof(theta_arg.c_str());
+        if (options.theta < 0.0) {
+            if (rank == 0) std::cerr << "[Error] --theta must be non-negative\n";
+            MPI_Abort(MPI_COMM_WORLD, 1);
+        }
+    }
+    options.compare_direct = cmdOptionExists(argv, argv + argc, "--compare-direct");
+
+    // Units: --gravity <G>, --softening <length>
+    std::string gravity_arg = getCmdOption(argv, argv + argc, "--gravity");
+    if (!gravity_arg.empty()) {
+        options.gravity = std::atof(gravity_arg.c_str());
+        if (options.gravity <= 0.0) {
+            if (rank == 0) std::cerr << "[Error] --gravity must be positive\n";
+            MPI_Abort(MPI_COMM_WORLD, 1);
+        }
+    }
+    std::string softening_arg = getCmdOption(argv, argv + argc, "--softening");
+    if (!softening_arg.empty()) {
+        options.softening = std::atof(softening_arg.c_str());
+        if (options.softening <= 0.0) {
+            // It bounds the force of close encounters; the self pair is masked in the kernels
+            if (rank == 0) std::cerr << "[Error] --softening must be positive\n";
+            MPI_Abort(MPI_COMM_WORLD, 1);
+        }
+    }
+
+    // Kernel precision: --precision double|mixed (direct solver only)
+    std::string precision_arg = getCmdOption(argv, argv + argc, "--precision");
+    if (precision_arg == "mixed") {
+        options.precision = nbody::Precision::Mixed;
+        if (options.solver != nbody::Solver::Direct) {
+            if (rank == 0) std::cerr << "[Error] --precision mixed is only available with the direct solver\n";
+            MPI_Abort(MPI_COMM_WORLD, 1);
+        }
+    } else if (!precision_arg.empty() && precision_arg != "double") {
+        if (rank == 0) std::cerr << "[Error] Unknown precision: " << precision_arg << " (expected double or mixed)\n";
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+
+    // Integrator selection: --integrator euler|leapfrog|verlet|yoshida4
+    std::string integrator_arg = getCmdOption(argv, argv + argc, "--integrator");
+    if (integrator_arg == "leapfrog" || integrator_arg == "verlet") {
+        options.integrator = nbody::Integrator::Leapfrog;
+    } else if (integrator_arg == "yoshida4") {
+        options.integrator = nbody::Integrator::Yoshida4;
+    } else if (!integrator_arg.empty() && integrator_arg != "euler") {
+        if (rank == 0) std::cerr << "[Error] Unknown integrator: " << integrator_arg << " (expected euler, leapfrog or yoshida4)\n";
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+
+    // Block timesteps: --block-levels <K> (leapfrog only), --eta <accuracy>
+    std::string levels_arg = getCmdOption(argv, argv + argc, "--block-levels");
+    if (!levels_arg.empty()) {
+        options.block_levels = std::atoi(levels_arg.c_str());
+        if (options.block_levels < 0 || options.block_levels > 20) {
+            if (rank == 0) std::cerr << "[Error] --block-levels must be between 0 and 20\n";
+            MPI_Abort(MPI_COMM_WORLD, 1);
+        }
+        if (options.block_levels > 0 && !integrator_arg.empty() && options.integrator != nbody::Integrator::Leapfrog) {
+            if (rank == 0) std::cerr << "[Error] Block timesteps are only available with the leapfrog integrator\n";
+            MPI_Abort(MPI_COMM_WORLD, 1);
+        }
+        if (options.block_levels > 0 && options.solver == nbody::Solver::Symmetric) {
+            if (rank == 0) std::cerr << "[Error] Block timesteps are not available with the symmetric solver, which always evaluates every pair\n";
+            MPI_Abort(MPI_COMM_WORLD, 1);
+        }
+        if (options.block_levels > 0) options.integrator = nbody::Integrator::Leapfrog;
+    }
+    std::string eta_arg = getCmdOption(argv, argv + argc, "--eta");
+    if (!eta_arg.empty()) {
+        options.eta = std::atof(eta_arg.c_str());
+        if (options.eta <= 0.0) {
+            if (rank == 0) std::cerr << "[Error] --eta must be positive\n";
+            MPI_Abort(MPI_COMM_WORLD, 1);
+        }
+    }
+
+    // Snapshots: --snapshot-every <K> [--snapshot-prefix <path prefix>]
+    std::string every_arg = getCmdOption(argv, argv + argc, "--snapshot-every");
+    if (!every_arg.empty()) {
+        options.snapshot_every = std::atoi(every_arg.c_str());
+        if (options.snapshot_every <= 0) {
+            if (rank == 0) std::cerr << "[Error] --snapshot-every must be positive\n";
+            MPI_Abort(MPI_COMM_WORLD, 1);
+        }
+    }
+    std::string prefix_arg = getCmdOption(argv, argv + argc, "--snapshot-prefix");
+    if (!prefix_arg.empty()) options.snapshot_prefix = prefix_arg;
+
+    // Conserved quantities: --diagnostics-every <K> [--diagnostics <path>]
+    std::string diagnostics_every_arg = getCmdOption(argv, argv + argc, "--diagnostics-every");
+    if (!diagnostics_every_arg.empty()) {
+        options.diagnostics_every = std::atoi(diagnostics_every_arg.c_str());
+        if (options.diagnostics_every <= 0) {
+            if (rank == 0) std::cerr << "[Error] --diagnostics-every must be positive\n";
+            MPI_Abort(MPI_COMM_WORLD, 1);
+        }
+    }
+    std::string diagnostics_arg = getCmdOption(argv, argv + argc, "--diagnostics");
+    if (!diagnostics_arg.empty()) options.diagnostics_path = diagnostics_arg;
+
+    // Load balancing: --rebalance-every <K> repartitions by measured cost
+    std::string rebalance_arg = getCmdOption(argv, argv + argc, "--rebalance-every");
+    if (!rebalance_arg.empty()) {
+        options.rebalance_every = std::atoi(rebalance_arg.c_str());
+        if (options.rebalance_every <= 0) {
+            if (rank == 0) std::cerr << "[Error] --rebalance-every must be positive\n";
+            MPI_Abort(MPI_COMM_WORLD, 1);
+        }
+        if (options.solver == nbody::Solver::Symmetric) {
+            if (rank == 0) std::cerr << "[Error] --rebalance-every does not apply to the symmetric solver, which splits work by pairs\n";
+            MPI_Abort(MPI_COMM_WORLD, 1);
+        }
+    }
+
+    // Body ordering: --reorder morton|hilbert [--reorder-every <K>]
+    std::string reorder_arg = getCmdOption(argv, argv + argc, "--reorder");
+    if (reorder_arg == "morton") {
+        options.ordering = nbody::Ordering::Morton;
+    } else if (reorder_arg == "hilbert") {
+        options.ordering = nbody::Ordering::Hilbert;
+    } else if (!reorder_arg.empty() && reorder_arg != "input") {
+        if (rank == 0) std::cerr << "[Error] Unknown ordering: " << reorder_arg << " (expected input, morton or hilbert)\n";
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+    std::string reorder_every_arg = getCmdOption(argv, argv + argc, "--reorder-every");
+    if (!reorder_every_arg.empty()) {
+        options.reorder_every = std::atoi(reorder_every_arg.c_str());
+        if (options.reorder_every <= 0) {
+            if (rank == 0) std::cerr << "[Error] --reorder-every must be positive\n";
+            MPI_Abort(MPI_COMM_WORLD, 1);
+        }
+    }
+
+    // Checkpoints: --checkpoint-every <K> [--checkpoint <path>], --restart <checkpoint>
+    std::string checkpoint_every_arg = getCmdOption(argv, argv + argc, "--checkpoint-every");
+    if (!checkpoint_every_arg.empty()) {
+        options.checkpoint_every = std::atoi(checkpoint_every_arg.c_str());
+        if (options.checkpoint_every <= 0) {
+            if (rank == 0) std::cerr << "[Error] --checkpoint-every must be positive\n";
+            MPI_Abort(MPI_COMM_WORLD, 1);
+        }
+    }
+    std::string checkpoint_arg = getCmdOption(argv, argv + argc, "--checkpoint");
+    if (!checkpoint_arg.empty()) options.checkpoint_path = checkpoint_arg;
+    std::string restart_file = getCmdOption(argv, argv + argc, "--restart");
+    if (!restart_file.empty()) input_file = restart_file;
+
+    // Output format: --format text|binary, binary by default for *.nbody files.
+    // --convert only translates the input into the output format.
+    std::string format_arg = getCmdOption(argv, argv + argc, "--format");
+    bool binary_output = output_file.size() > 6 && output_file.compare(output_file.size() - 6, 6, ".nbody") == 0;
+    if (format_arg == "binary") {
+        binary_output = true;
+    } else if (format_arg == "text") {
+        binary_output = false;
+    } else if (!format_arg.empty()) {
+        if (rank == 0) std::cerr << "[Error] Unknown format: " << format_arg << " (expected text or binary)\n";
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+    bool convert_only = cmdOptionExists(argv, argv + argc, "--convert");
+
     nbody::SystemState initial_bodies;
     double dt = 0.1;
     int steps = 10;
+    int dimensions = 2;
+
+    nbody::DomainDecomposition dom(rank, size);
+    nbody::Simulation sim(dom, options);
+
+    // 1. Read Data: binary files are read in parallel, each rank its own slice
+    int binary_input = rank == 0 && nbody::IO::isBinary(input_file) ? 1 : 0;
+    MPI_Bcast(&binary_input, 1, MPI_INT, 0, MPI_COMM_WORLD);
 
-    // 1. Rank 0 Reads Data
-    if (rank == 0) {
+    if (!binary_input && !restart_file.empty()) {
+        if (rank == 0) std::cerr << "[Error] --restart needs a binary checkpoint or snapshot: " << restart_file << "\n";
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+
+    if (binary_input) {
         try {
-            auto params = nbody::IO::readInput(input_file, initial_bodies);
-            dt = params.first;
-            steps = params.second;
+            // A restart may use any rank count: readBinary re-partitions by
+            // reading this rank's slice under the current decomposition
+            std::vector<double> extra;
+            nbody::BinaryHeader header = nbody::IO::readBinary(input_file, dom, initial_bodies, &extra);
+            dt = header.dt;
+            steps = header.steps;
+            dimensions = header.dimensions;
+            sim.initLocal(initial_bodies, static_cast<int>(header.count), dimensions);
+            if (!restart_file.empty()) {
+                if (header.fields != nbody::IO::stateFields(dimensions) + nbody::Simulation::checkpointFields(dimensions)) {
+                    extra.clear();
+                }
+                sim.restore(extra, header.step);
+            }
         } catch (const std::exception& e) {
-            std::cerr << "[Error] Rank 0 failed to read input: " << e.what() << "\n";
+            std::cerr << "[Error] Rank " << rank << " failed to read input: " << e.what() << "\n";
             MPI_Abort(MPI_COMM_WORLD, 1);
         }
-    }
+    } else {
+        // Text: Rank 0 Reads Data
+        if (rank == 0) {
+            try {
+                auto params = nbody::IO::readInput(input_file, initial_bodies, dimensions);
+                dt = params.first;
+                steps = params.second;
+            } catch (const std::exception& e) {
+                std::cerr << "[Error] Rank 0 failed to read input: " << e.what() << "\n";
+                MPI_Abort(MPI_COMM_WORLD, 1);
+            }
+        }
 
-    // 2. Broadcast Config
-    MPI_Bcast(&steps, 1, MPI_INT, 0, MPI_COMM_WORLD);
-    MPI_Bcast(&dt, 1, MPI_DOUBLE, 0, MPI_COMM_WORLD);
+        // Broadcast Config
+        MPI_Bcast(&steps, 1, MPI_INT, 0, MPI_COMM_WORLD);
+        MPI_Bcast(&dt, 1, MPI_DOUBLE, 0, MPI_COMM_WORLD);
+        MPI_Bcast(&dimensions, 1, MPI_INT, 0, MPI_COMM_WORLD);
 
-    // 3. Setup Simulation
-    nbody::DomainDecomposition dom(rank, size);
-    nbody::Simulation sim(dom);
+        // Distribute Data (Scatter)
+        // Rank 0 passes the filled vector, others pass empty/ignored vector
+        sim.init(initial_bodies, dimensions);
+    }
 
-    // 4. Distribute Data (Scatter)
-    // Rank 0 passes the filled vector, others pass empty/ignored vector
-    sim.init(initial_bodies);
+    // The quadtree and the curve keys are 2D only
+    if (dimensions == 3 && !convert_only &&
+        (options.solver == nbody::Solver::BarnesHut || options.ordering != nbody::Ordering::Input)) {
+        if (rank == 0) std::cerr << "[Error] 3D bodies need the direct or symmetric solver without --reorder\n";
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
 
-    // 5. Run Parallel Simulation
-    sim.run(steps, dt);
+    // 2. Run Parallel Simulation
+    if (!convert_only) {
+        try {
+            sim.run(steps, dt);
+        } catch (const std::exception& e) {
+            std::cerr << "[Error] Rank " << rank << " failed: " << e.what() << "\n";
+            MPI_Abort(MPI_COMM_WORLD, 1);
+        }
+    }
 
-    // 6. Gather & Output
-    if (rank == 0) {
+    // 3. Output: binary in parallel, text gathered to rank 0
+    if (binary_output) {
+        try {
+            // The simulation's decomposition: rebalancing may have moved the ranges
+            nbody::IO::writeBinary(output_file, sim.domain(), sim.localBodies(), sim.totalBodies(), dimensions, dt,
+                                   steps);
+        } catch (const std::exception& e) {
+            std::cerr << "[Error] Rank " << rank << " failed to write output: " << e.what() << "\n";
+            MPI_Abort(MPI_COMM_WORLD, 1);
+        }
+    } else if (rank == 0) {
         nbody::SystemState final_bodies = sim.gatherFinalState();
-        nbody::IO::writeOutput(output_file, final_bodies, dt, steps);
+        nbody::IO::writeOutput(output_file, final_bodies, dt, steps, dimensions);
     } else {
         // Non-root ranks still participate in the Gatherv inside this function
         sim.gatherFinalState();